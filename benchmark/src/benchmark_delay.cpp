@@ -0,0 +1,437 @@
+#include <plugin_processor.h>
+#include <delay.h>
+#include <benchmark/benchmark.h>
+#include <random>
+#include <type_traits>
+
+namespace audio_plugin_benchmark {
+namespace {
+const std::vector<int64_t> sampleRates{44100, 48000, 96000, 192000};
+const std::vector<int64_t> blockSizes{16, 32, 64, 128, 256, 512, 1024, 2048};
+
+// Deterministic white noise, so runs are comparable between builds
+std::vector<float> makeNoise(size_t numSamples, unsigned seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> dist(-0.5f, 0.5f);
+
+  std::vector<float> noise(numSamples);
+  for (auto& sample : noise)
+    sample = dist(rng);
+  return noise;
+}
+
+Delay::Parameters makeParameters(Delay::DelayMode mode) {
+  Delay::Parameters p;
+  p.delayTimeSeconds = 0.33f;
+  p.feedback = 0.6f;
+  p.wetLevel = 0.5f;
+  p.dryLevel = 1.0f;
+  p.hiCutFreq = 9800.0f;
+  p.modulationDepthSeconds = 0.2f;
+  p.modulationRateHz = 2.0f;
+  p.mode = mode;
+  return p;
+}
+
+// Reports ns/sample and real-time factor (seconds of audio per second of CPU)
+void setCounters(benchmark::State& state, int64_t samplesPerIteration, double sampleRate) {
+  state.SetItemsProcessed(state.iterations() * samplesPerIteration);
+  state.counters["ns_per_sample"] =
+      benchmark::Counter(static_cast<double>(samplesPerIteration) * 1e-9,
+                         benchmark::Counter::kIsIterationInvariantRate |
+                             benchmark::Counter::kInvert);
+  state.counters["realtime_factor"] =
+      benchmark::Counter(static_cast<double>(samplesPerIteration) / sampleRate,
+                         benchmark::Counter::kIsIterationInvariantRate);
+}
+}  // namespace
+
+// Each iteration restores the input from a pristine copy, as processing is in-place
+void BM_DelayMono(benchmark::State& state) {
+  const auto sampleRate = static_cast<double>(state.range(0));
+  const auto blockSize = static_cast<int>(state.range(1));
+
+  Delay delay;
+  delay.setSampleRate(sampleRate);
+  delay.setParameters(makeParameters(Delay::DelayMode::Mono));
+
+  const auto input = makeNoise(static_cast<size_t>(blockSize), 1);
+  std::vector<float> buffer(input.size());
+
+  for (auto _ : state) {
+    std::copy(input.begin(), input.end(), buffer.begin());
+    delay.processMono(buffer.data(), blockSize);
+    benchmark::DoNotOptimize(buffer.data());
+    benchmark::ClobberMemory();
+  }
+
+  setCounters(state, blockSize, sampleRate);
+}
+BENCHMARK(BM_DelayMono)
+    ->ArgNames({"sampleRate", "blockSize"})
+    ->ArgsProduct({sampleRates, blockSizes});
+
+void BM_DelayStereo(benchmark::State& state) {
+  const auto mode = static_cast<Delay::DelayMode>(state.range(0));
+  const auto sampleRate = static_cast<double>(state.range(1));
+  const auto blockSize = static_cast<int>(state.range(2));
+  const auto kernel = static_cast<Delay::Kernel>(state.range(3));
+
+  Delay delay;
+  delay.setSampleRate(sampleRate);
+  delay.setKernel(kernel);
+  delay.setParameters(makeParameters(mode));
+
+  const auto inputL = makeNoise(static_cast<size_t>(blockSize), 1);
+  const auto inputR = makeNoise(static_cast<size_t>(blockSize), 2);
+  std::vector<float> left(inputL.size()), right(inputR.size());
+
+  for (auto _ : state) {
+    std::copy(inputL.begin(), inputL.end(), left.begin());
+    std::copy(inputR.begin(), inputR.end(), right.begin());
+    delay.processStereo(left.data(), right.data(), blockSize);
+    benchmark::DoNotOptimize(left.data());
+    benchmark::DoNotOptimize(right.data());
+    benchmark::ClobberMemory();
+  }
+
+  setCounters(state, blockSize, sampleRate);
+}
+BENCHMARK(BM_DelayStereo)
+    ->ArgNames({"mode", "sampleRate", "blockSize", "kernel"})
+    ->ArgsProduct({{0, 1, 2}, sampleRates, blockSizes, {0, 1}});
+
+// Float buffers on a Float32 line against double buffers on a Float64 line, as the plugin
+// runs them, at a typical device setting. The double loop always takes the scalar kernel.
+template <typename Sample>
+void BM_DelayPrecision(benchmark::State& state) {
+  const double sampleRate = 48000.0;
+  const int blockSize = 256;
+
+  Delay delay;
+  delay.setStorageFormat(std::is_same_v<Sample, double> ? Delay::StorageFormat::Float64
+                                                        : Delay::StorageFormat::Float32);
+  delay.setSampleRate(sampleRate);
+  delay.setKernel(static_cast<Delay::Kernel>(state.range(1)));
+  delay.setParameters(makeParameters(static_cast<Delay::DelayMode>(state.range(0))));
+
+  const auto noiseL = makeNoise(static_cast<size_t>(blockSize), 1);
+  const auto noiseR = makeNoise(static_cast<size_t>(blockSize), 2);
+  const std::vector<Sample> inputL(noiseL.begin(), noiseL.end());
+  const std::vector<Sample> inputR(noiseR.begin(), noiseR.end());
+  std::vector<Sample> left(inputL.size()), right(inputR.size());
+
+  for (auto _ : state) {
+    std::copy(inputL.begin(), inputL.end(), left.begin());
+    std::copy(inputR.begin(), inputR.end(), right.begin());
+    delay.processStereo(left.data(), right.data(), blockSize);
+    benchmark::DoNotOptimize(left.data());
+    benchmark::DoNotOptimize(right.data());
+    benchmark::ClobberMemory();
+  }
+
+  setCounters(state, blockSize, sampleRate);
+}
+BENCHMARK_TEMPLATE(BM_DelayPrecision, float)
+    ->ArgNames({"mode", "kernel"})
+    ->ArgsProduct({{0, 1, 2}, {0, 1}});
+BENCHMARK_TEMPLATE(BM_DelayPrecision, double)
+    ->ArgNames({"mode", "kernel"})
+    ->ArgsProduct({{0, 1, 2}, {0, 1}});
+
+// Cost of each fractional-delay interpolation policy at a typical device setting
+void BM_DelayInterpolation(benchmark::State& state) {
+  const double sampleRate = 48000.0;
+  const int blockSize = 256;
+
+  Delay delay;
+  delay.setSampleRate(sampleRate);
+  delay.setKernel(static_cast<Delay::Kernel>(state.range(1)));
+
+  auto params = makeParameters(Delay::DelayMode::Stereo);
+  params.interpolation = static_cast<Delay::Interpolation>(state.range(0));
+  delay.setParameters(params);
+
+  const auto inputL = makeNoise(static_cast<size_t>(blockSize), 1);
+  const auto inputR = makeNoise(static_cast<size_t>(blockSize), 2);
+  std::vector<float> left(inputL.size()), right(inputR.size());
+
+  for (auto _ : state) {
+    std::copy(inputL.begin(), inputL.end(), left.begin());
+    std::copy(inputR.begin(), inputR.end(), right.begin());
+    delay.processStereo(left.data(), right.data(), blockSize);
+    benchmark::DoNotOptimize(left.data());
+    benchmark::DoNotOptimize(right.data());
+    benchmark::ClobberMemory();
+  }
+
+  setCounters(state, blockSize, sampleRate);
+}
+BENCHMARK(BM_DelayInterpolation)
+    ->ArgNames({"interpolation", "kernel"})
+    ->ArgsProduct({{0, 1, 2, 3, 4}, {0, 1}});
+
+// Each hi-cut slope, with and without the low-cut, on both stereo kernels
+void BM_DelayFilter(benchmark::State& state) {
+  const double sampleRate = 48000.0;
+  const int blockSize = 256;
+
+  Delay delay;
+  delay.setSampleRate(sampleRate);
+  delay.setKernel(static_cast<Delay::Kernel>(state.range(2)));
+
+  auto params = makeParameters(Delay::DelayMode::Stereo);
+  params.hiCutSlope = static_cast<FeedbackFilter::Slope>(state.range(0));
+  params.lowCutFreq = state.range(1) != 0 ? 150.0f : 0.0f;
+  delay.setParameters(params);
+
+  const auto inputL = makeNoise(static_cast<size_t>(blockSize), 1);
+  const auto inputR = makeNoise(static_cast<size_t>(blockSize), 2);
+  std::vector<float> left(inputL.size()), right(inputR.size());
+
+  for (auto _ : state) {
+    std::copy(inputL.begin(), inputL.end(), left.begin());
+    std::copy(inputR.begin(), inputR.end(), right.begin());
+    delay.processStereo(left.data(), right.data(), blockSize);
+    benchmark::DoNotOptimize(left.data());
+    benchmark::DoNotOptimize(right.data());
+    benchmark::ClobberMemory();
+  }
+
+  setCounters(state, blockSize, sampleRate);
+}
+BENCHMARK(BM_DelayFilter)
+    ->ArgNames({"slope", "lowCut", "kernel"})
+    ->ArgsProduct({{0, 1, 2}, {0, 1}, {0, 1}});
+
+// One instance over a discrete layout, with linked channel offsets off or spread
+void BM_DelayMultichannel(benchmark::State& state) {
+  const double sampleRate = 48000.0;
+  const int blockSize = 256;
+  const auto numChannels = static_cast<int>(state.range(0));
+
+  Delay delay;
+  delay.setNumChannels(numChannels);
+  delay.setSampleRate(sampleRate);
+
+  auto params = makeParameters(Delay::DelayMode::Stereo);
+  params.channelSpreadSeconds = state.range(1) != 0 ? 0.05f : 0.0f;
+  delay.setParameters(params);
+
+  std::vector<std::vector<float>> inputs, buffers;
+  std::vector<float*> channels;
+  for (int c = 0; c < numChannels; ++c) {
+    inputs.push_back(makeNoise(static_cast<size_t>(blockSize), static_cast<unsigned>(c + 1)));
+    buffers.push_back(inputs.back());
+    channels.push_back(buffers.back().data());
+  }
+
+  for (auto _ : state) {
+    for (size_t c = 0; c < inputs.size(); ++c)
+      std::copy(inputs[c].begin(), inputs[c].end(), buffers[c].begin());
+    delay.processMultichannel(channels.data(), blockSize);
+    benchmark::DoNotOptimize(channels.data());
+    benchmark::ClobberMemory();
+  }
+
+  setCounters(state, static_cast<int64_t>(blockSize) * numChannels, sampleRate * numChannels);
+}
+BENCHMARK(BM_DelayMultichannel)
+    ->ArgNames({"channels", "spread"})
+    ->ArgsProduct({{4, 8, 16}, {0, 1}});
+
+// The same channel count as a rack of stereo instances, for comparison with the above
+void BM_DelayStereoRack(benchmark::State& state) {
+  const double sampleRate = 48000.0;
+  const int blockSize = 256;
+  const auto numChannels = static_cast<int>(state.range(0));
+
+  std::vector<Delay> rack(static_cast<size_t>(numChannels / 2));
+  for (auto& delay : rack) {
+    delay.setSampleRate(sampleRate);
+    delay.setParameters(makeParameters(Delay::DelayMode::Stereo));
+  }
+
+  std::vector<std::vector<float>> inputs, buffers;
+  for (int c = 0; c < numChannels; ++c) {
+    inputs.push_back(makeNoise(static_cast<size_t>(blockSize), static_cast<unsigned>(c + 1)));
+    buffers.push_back(inputs.back());
+  }
+
+  for (auto _ : state) {
+    for (size_t c = 0; c < inputs.size(); ++c)
+      std::copy(inputs[c].begin(), inputs[c].end(), buffers[c].begin());
+    for (size_t i = 0; i < rack.size(); ++i)
+      rack[i].processStereo(buffers[2 * i].data(), buffers[2 * i + 1].data(), blockSize);
+    benchmark::DoNotOptimize(buffers.data());
+    benchmark::ClobberMemory();
+  }
+
+  setCounters(state, static_cast<int64_t>(blockSize) * numChannels, sampleRate * numChannels);
+}
+BENCHMARK(BM_DelayStereoRack)->ArgName("channels")->Arg(4)->Arg(8)->Arg(16);
+
+// One instance reading up to Delay::maxTaps taps from its line
+void BM_DelayTaps(benchmark::State& state) {
+  const double sampleRate = 48000.0;
+  const int blockSize = 256;
+
+  Delay delay;
+  delay.setSampleRate(sampleRate);
+
+  auto params = makeParameters(Delay::DelayMode::Stereo);
+  params.numTaps = static_cast<int>(state.range(0));
+  for (size_t t = 0; t < params.taps.size(); ++t)
+    params.taps[t] = {0.04f * static_cast<float>(t + 1), 0.125f, 0.5f, t % 2 == 0 ? -0.5f : 0.5f};
+  delay.setParameters(params);
+
+  const auto inputL = makeNoise(static_cast<size_t>(blockSize), 1);
+  const auto inputR = makeNoise(static_cast<size_t>(blockSize), 2);
+  std::vector<float> left(inputL.size()), right(inputR.size());
+
+  for (auto _ : state) {
+    std::copy(inputL.begin(), inputL.end(), left.begin());
+    std::copy(inputR.begin(), inputR.end(), right.begin());
+    delay.processStereo(left.data(), right.data(), blockSize);
+    benchmark::DoNotOptimize(left.data());
+    benchmark::DoNotOptimize(right.data());
+    benchmark::ClobberMemory();
+  }
+
+  setCounters(state, blockSize, sampleRate);
+}
+BENCHMARK(BM_DelayTaps)->ArgName("taps")->Arg(0)->Arg(1)->Arg(2)->Arg(4)->Arg(8);
+
+// The same echoes from instances in series, one per tap, for comparison with the above
+void BM_DelaySeries(benchmark::State& state) {
+  const double sampleRate = 48000.0;
+  const int blockSize = 256;
+
+  std::vector<Delay> series(static_cast<size_t>(state.range(0)));
+  for (size_t i = 0; i < series.size(); ++i) {
+    auto params = makeParameters(Delay::DelayMode::Stereo);
+    params.delayTimeSeconds = 0.04f * static_cast<float>(i + 1);
+    series[i].setSampleRate(sampleRate);
+    series[i].setParameters(params);
+  }
+
+  const auto inputL = makeNoise(static_cast<size_t>(blockSize), 1);
+  const auto inputR = makeNoise(static_cast<size_t>(blockSize), 2);
+  std::vector<float> left(inputL.size()), right(inputR.size());
+
+  for (auto _ : state) {
+    std::copy(inputL.begin(), inputL.end(), left.begin());
+    std::copy(inputR.begin(), inputR.end(), right.begin());
+    for (auto& delay : series)
+      delay.processStereo(left.data(), right.data(), blockSize);
+    benchmark::DoNotOptimize(left.data());
+    benchmark::DoNotOptimize(right.data());
+    benchmark::ClobberMemory();
+  }
+
+  setCounters(state, blockSize, sampleRate);
+}
+BENCHMARK(BM_DelaySeries)->ArgName("instances")->Arg(1)->Arg(2)->Arg(4)->Arg(8);
+
+// The Diffuse mode's network with each interpolation policy, for comparison with
+// BM_DelayInterpolation and two instances of BM_DelaySeries
+void BM_DelayDiffuse(benchmark::State& state) {
+  const double sampleRate = 48000.0;
+  const int blockSize = 256;
+
+  Delay delay;
+  delay.setNetworkLayout(true);
+  delay.setSampleRate(sampleRate);
+
+  auto params = makeParameters(Delay::DelayMode::Diffuse);
+  params.interpolation = static_cast<Delay::Interpolation>(state.range(0));
+  delay.setParameters(params);
+
+  const auto inputL = makeNoise(static_cast<size_t>(blockSize), 1);
+  const auto inputR = makeNoise(static_cast<size_t>(blockSize), 2);
+  std::vector<float> left(inputL.size()), right(inputR.size());
+
+  for (auto _ : state) {
+    std::copy(inputL.begin(), inputL.end(), left.begin());
+    std::copy(inputR.begin(), inputR.end(), right.begin());
+    delay.processStereo(left.data(), right.data(), blockSize);
+    benchmark::DoNotOptimize(left.data());
+    benchmark::DoNotOptimize(right.data());
+    benchmark::ClobberMemory();
+  }
+
+  setCounters(state, blockSize, sampleRate);
+}
+BENCHMARK(BM_DelayDiffuse)->ArgName("interpolation")->Arg(0)->Arg(1)->Arg(2)->Arg(3)->Arg(4);
+
+// Storage formats with a long line, where reads miss the cache and bandwidth dominates
+void BM_DelayStorage(benchmark::State& state) {
+  const double sampleRate = 48000.0;
+  const int blockSize = 256;
+  const auto numChannels = static_cast<int>(state.range(1));
+
+  Delay delay;
+  delay.setStorageFormat(static_cast<Delay::StorageFormat>(state.range(0)));
+  delay.setMaxDelayTime(Delay::maxDelayLimit);
+  delay.setNumChannels(numChannels);
+  delay.setSampleRate(sampleRate);
+  delay.setKernel(static_cast<Delay::Kernel>(state.range(2)));
+
+  auto params = makeParameters(Delay::DelayMode::Stereo);
+  params.delayTimeSeconds = 20.0f;
+  delay.setParameters(params);
+
+  std::vector<std::vector<float>> inputs, buffers;
+  std::vector<float*> channels;
+  for (int c = 0; c < numChannels; ++c) {
+    inputs.push_back(makeNoise(static_cast<size_t>(blockSize), static_cast<unsigned>(c + 1)));
+    buffers.push_back(inputs.back());
+    channels.push_back(buffers.back().data());
+  }
+
+  for (auto _ : state) {
+    for (size_t c = 0; c < inputs.size(); ++c)
+      std::copy(inputs[c].begin(), inputs[c].end(), buffers[c].begin());
+    if (numChannels == 2)
+      delay.processStereo(channels[0], channels[1], blockSize);
+    else
+      delay.processMultichannel(channels.data(), blockSize);
+    benchmark::DoNotOptimize(channels.data());
+    benchmark::ClobberMemory();
+  }
+
+  setCounters(state, static_cast<int64_t>(blockSize) * numChannels, sampleRate * numChannels);
+  state.counters["line_bytes"] = static_cast<double>(delay.getDelayLineBytes());
+}
+BENCHMARK(BM_DelayStorage)
+    ->ArgNames({"format", "channels", "kernel"})
+    ->ArgsProduct({{0, 1, 2}, {2, 8}, {0, 1}});
+
+// Full plugin path: parameter reads, play head query and stereo processing
+void BM_ProcessBlock(benchmark::State& state) {
+  const auto sampleRate = static_cast<double>(state.range(0));
+  const auto blockSize = static_cast<int>(state.range(1));
+
+  audio_plugin::AudioPluginAudioProcessor processor;
+  processor.prepareToPlay(sampleRate, blockSize);
+
+  const auto inputL = makeNoise(static_cast<size_t>(blockSize), 1);
+  const auto inputR = makeNoise(static_cast<size_t>(blockSize), 2);
+  juce::AudioBuffer<float> buffer(2, blockSize);
+  juce::MidiBuffer midi;
+
+  for (auto _ : state) {
+    buffer.copyFrom(0, 0, inputL.data(), blockSize);
+    buffer.copyFrom(1, 0, inputR.data(), blockSize);
+    processor.processBlock(buffer, midi);
+    benchmark::DoNotOptimize(buffer.getReadPointer(0));
+    benchmark::ClobberMemory();
+  }
+
+  processor.releaseResources();
+  setCounters(state, blockSize, sampleRate);
+}
+BENCHMARK(BM_ProcessBlock)
+    ->ArgNames({"sampleRate", "blockSize"})
+    ->ArgsProduct({sampleRates, blockSizes});
+}  // namespace audio_plugin_benchmark
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/**
+ * Local control endpoint for builds without an editor: a Unix domain socket serviced by its
+ * own thread, so a control daemon on the device can change parameters, recall presets and
+ * read telemetry without going through the host. Only built with ENABLE_CONTROL_SOCKET, see
+ * plugin/CMakeLists.txt.
+ *
+ * The protocol is one request per line, answered with one line:
+ *
+ *   set <id> <value> [<id> <value> ...]   a batch, applied in one block     -> ok | error ...
+ *   preset <index>                        recalls a preset                  -> ok | error ...
+ *   status                                telemetry as a JSON object
+ *
+ * Values are in the parameter's own units (choices by index) and clamped to its range. A
+ * batch is checked as a whole before any of it is queued, and reaches the audio thread
+ * through a wait-free single-producer, single-consumer FIFO (juce::AbstractFifo); the audio
+ * thread drains at most `maxChangesPerBlock` changes per block and never splits a batch. The
+ * latest value of each parameter is also kept for the message thread, which moves the
+ * parameters themselves so that hosts and saved state follow. When the FIFO is full the
+ * batch is refused with "error busy" rather than waiting.
+ */
+class ControlServer : private juce::Thread {
+public:
+  static constexpr int capacity = 256;
+  static constexpr int maxChangesPerBlock = 64;  // also the largest batch
+  static constexpr int maxClients = 4;
+
+  struct Parameter {
+    juce::String id;
+    juce::NormalisableRange<float> range;
+  };
+
+  // Socket thread: the body of a status reply
+  using Telemetry = std::function<juce::var()>;
+
+  // Listens on `socketPath` (replacing a stale socket left there) until destroyed; if that
+  // fails, including when another server answers there, it logs why and serves nothing
+  ControlServer(const juce::String& socketPath,
+                std::vector<Parameter> parametersToControl,
+                Telemetry telemetryToReport);
+  ~ControlServer() override;
+
+  bool isListening() const { return listener >= 0; }
+  const juce::String& getPath() const { return path; }
+
+  // Audio thread: hands whole batches to `apply(index, value)`, oldest first, while they fit
+  // in `maxChanges`
+  template <typename Fn>
+  int drainChanges(int maxChanges, Fn&& apply) {
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(fifo.getNumReady(), start1, size1, start2, size2);
+
+    auto at = [&](int k) -> const Change& {
+      return queue[static_cast<size_t>(k < size1 ? start1 + k : start2 + k - size1)];
+    };
+
+    int numDrained = 0;
+    while (numDrained < size1 + size2) {
+      const int batchSize = static_cast<int>(at(numDrained).batchSize);
+      if (numDrained + batchSize > maxChanges)
+        break;
+      for (int k = numDrained; k < numDrained + batchSize; ++k)
+        apply(static_cast<size_t>(at(k).index), at(k).value);
+      numDrained += batchSize;
+    }
+
+    fifo.finishedRead(numDrained);
+    return numDrained;
+  }
+
+  // Message thread: the last preset requested since the previous call, or -1
+  int takePresetRequest() { return requestedPreset.exchange(-1); }
+
+  // Message thread: how many presets there are, so requests past them are refused
+  void setNumPresets(int numPresetsToOffer) { numPresets.store(numPresetsToOffer); }
+
+  // Message thread: hands every parameter set since the previous call to `apply(index,
+  // value)`, with its latest value
+  template <typename Fn>
+  void forEachParameterChange(Fn&& apply) {
+    for (size_t i = 0; i < parameters.size(); ++i)
+      if (parameterChanged[i].exchange(false, std::memory_order_acquire))
+        apply(i, parameterValues[i].load(std::memory_order_relaxed));
+  }
+
+private:
+  struct Change {
+    uint32_t index = 0;
+    float value = 0.0f;
+    uint32_t batchSize = 0;  // on the first change of a batch
+  };
+
+  struct Client {
+    int socket = -1;
+    std::string pending;  // received, up to the next newline
+  };
+
+  void run() override;
+  bool serve(Client& client);
+  juce::String handle(const juce::String& request);
+  juce::String handleSet(const juce::StringArray& tokens);
+  juce::String handlePreset(const juce::StringArray& tokens);
+
+  const juce::String path;
+  const std::vector<Parameter> parameters;
+  const Telemetry telemetry;
+  int listener = -1;
+  std::vector<Client> clients;  // socket thread
+
+  juce::AbstractFifo fifo{capacity};
+  std::array<Change, capacity> queue;
+
+  std::atomic<int> requestedPreset{-1};
+  std::atomic<int> numPresets{0};
+  std::unique_ptr<std::atomic<float>[]> parameterValues;
+  std::unique_ptr<std::atomic<bool>[]> parameterChanged;
+};
@@ -1,11 +1,48 @@
 #pragma once
 
-#include <vector>
 #include <juce_audio_processors/juce_audio_processors.h>
-#include <juce_dsp/juce_dsp.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <type_traits>
+#include "delay_line.h"
+#include "feedback_filter.h"
+#include "interpolation.h"
+#include "lfo.h"
+#include "read_heads.h"
+#include "sample_format.h"
 class Delay {
 public:
-  enum class DelayMode { Mono, Stereo, PingPong };
+  // Diffuse runs the mono and stereo repeats through a feedback delay network, see
+  // processNetworkRun; processMultichannel treats it as Stereo
+  enum class DelayMode { Mono, Stereo, PingPong, Diffuse };
+
+  // Discrete channels handled by processMultichannel
+  static constexpr int maxChannels = 16;
+
+  // Upper bound for setMaxDelayTime, in seconds
+  static constexpr double maxDelayLimit = 30.0;
+
+  // Extra read positions of the multi-tap mode, see Parameters::taps
+  static constexpr int maxTaps = 8;
+
+  // Input and repeats below this level (-100 dBFS) count as silence
+  static constexpr float silenceThreshold = 1.0e-5f;
+
+  // Inner loop used by processStereo (A/B switch, Simd falls back to scalar lanes when
+  // the build has DELAY_SIMD=0). Reference takes the general scalar path for every run of
+  // every process call, and per-lane reads in processMultichannel: the plain implementation
+  // the others are checked against (test_golden.cpp), not meant for real-time use.
+  enum class Kernel { Scalar, Simd, Reference };
+
+  // How the read position reaches a new delay time
+  using TimeChange = ReadHeads::Mode;
+
+  // Fractional-delay read between buffer samples, see interpolation.h
+  using Interpolation = interpolation::Type;
+
+  // How the delay line stores samples, see sample_format.h
+  using StorageFormat = sample_format::Type;
 
   struct Parameters {
     float delayTimeSeconds = 0.5f;
@@ -13,43 +50,271 @@ public:
     float wetLevel = 0.5f;
     float dryLevel = 0.5f;
 
-    float hiCutFreq = 0.0f;  // in Hz
+    // Filters in the feedback path, in Hz; 0 (or anything outside 20 Hz .. Nyquist) turns
+    // the low-cut off and leaves the hi-cut at its last cutoff
+    float hiCutFreq = 0.0f;
+    FeedbackFilter::Slope hiCutSlope = FeedbackFilter::Slope::dB12;
+    float lowCutFreq = 0.0f;
 
     float modulationDepthSeconds = 0.002f;
     float modulationRateHz = 0.25f;
+    float modulationPhaseOffset = 0.0f;  // right channel vs. left, in cycles (stereo width)
 
     bool syncToTempo = false;
     float hostBpm = 120.0f;
     float noteDivision = 0.25f;  // quarter = 0.25, dotted eighth = 0.1875 etc.
 
+    TimeChange timeChange = TimeChange::Crossfade;
+    float timeChangeSeconds = 0.1f;  // crossfade window or glide time
+
+    Interpolation interpolation = Interpolation::Linear;
+
+    // Extra delay per channel in processMultichannel: spread evenly from the first channel
+    // (0 s) to the last (channelSpreadSeconds) when linked, otherwise set per channel
+    bool linkChannelOffsets = true;
+    float channelSpreadSeconds = 0.0f;
+    std::array<float, maxChannels> channelOffsetSeconds{};
+
+    // Multi-tap (processMono and processStereo): the first numTaps taps read the same line
+    // at their own time, or note division when synced, and are mixed into the wet signal
+    // with their level and pan (-1 left .. 1 right). The repeats still come from the main
+    // delay time alone.
+    struct Tap {
+      float delayTimeSeconds = 0.25f;
+      float noteDivision = 0.125f;
+      float level = 0.0f;
+      float pan = 0.0f;
+    };
+    int numTaps = 0;
+    std::array<Tap, maxTaps> taps{};
+
     DelayMode mode = DelayMode::Stereo;
   };
 
   Delay();
+  ~Delay();
 
   void setSampleRate(double newSampleRate);
   void setParameters(const Parameters& params);
 
-  void processMono(float* samples, int numSamples);
-  void processStereo(float* left, float* right, int numSamples);
+  // Channel count for processMultichannel, applied by the next setSampleRate
+  void setNumChannels(int newNumChannels);
+  int getNumChannels() const { return numChannels; }
+
+  // Longest delay the line holds, applied by the next setSampleRate
+  void setMaxDelayTime(double seconds);
+  double getMaxDelayTime() const { return maxDelayTime; }
+
+  // Sample format of the line, applied by the next setSampleRate
+  void setStorageFormat(StorageFormat newFormat) { storageFormat = newFormat; }
+  StorageFormat getStorageFormat() const { return storageFormat; }
+
+  // Whether mono and stereo lines are laid out for the Diffuse mode's network (a lane per
+  // network line) rather than as L/R frames, applied by the next setSampleRate. The network
+  // only runs on such a line and the other modes only on L/R ones; until the line for the
+  // current mode is swapped in, both sound as Stereo.
+  void setNetworkLayout(bool network) { networkLayout = network; }
+  bool hasNetworkLayout() const { return networkLayout; }
+
+  // Size of the current line's storage
+  size_t getDelayLineBytes() const { return delayLine->getSizeInBytes(); }
+
+  // Time for the repeats of a full-scale input to decay below silenceThreshold with the
+  // current feedback and delay times, as of the last setParameters
+  double getTailSeconds() const { return tailSeconds; }
+
+  // True while the last block took the idle path: the input had been silent for longer than
+  // the repeats of what came before it need to decay, so only the dry signal was applied
+  bool isIdle() const { return idle; }
+
+  // Level of the line at each of the first `numRepeats` repeat positions (RMS over all
+  // channels, probed across the `windowSamples` behind each), scaled by the wet level and
+  // the feedback that repeat has been through. For meters; call on the audio thread.
+  void getRepeatLevels(float* levels, int numRepeats, int windowSamples) const;
+
+  // Resizing while processing: build a line with createDelayLine and submitDelayLine it
+  // from any thread but the audio thread. Process calls copy the audible history over to it
+  // a bounded part at a time, swap it in once it has caught up, and hand the old one back to
+  // be freed by releaseRetiredDelayLine (or the next submit) on that other thread. The line's
+  // settings are its own: the ones above stay as they are, for the next setSampleRate, and
+  // processing takes the longest delay, format and layout from whichever line it runs on.
+  std::unique_ptr<DelayLine> createDelayLine(double maxDelaySeconds,
+                                             StorageFormat format,
+                                             bool network) const;
+  void submitDelayLine(std::unique_ptr<DelayLine> line);
+  void releaseRetiredDelayLine();
+
+  // Buffers of float or double samples. Either way the kernels read and write them in place,
+  // converting per sample. The feedback loop runs in the precision of the line's format: in
+  // double on a Float64 line, where mono and stereo take the scalar kernels (taps, the
+  // network and multichannel layouts still compute in float and only store doubles), and in
+  // float otherwise.
+  template <typename Sample>
+  void processMono(Sample* samples, int numSamples);
+  template <typename Sample>
+  void processStereo(Sample* left, Sample* right, int numSamples);
+
+  // 3 to maxChannels discrete channels. In PingPong mode each repeat moves on to the next
+  // channel (the last one feeds the first); the other modes keep channels independent.
+  template <typename Sample>
+  void processMultichannel(Sample* const* channels, int numSamples);
+
+  void setKernel(Kernel newKernel) { kernel = newKernel; }
+  Kernel getKernel() const { return kernel; }
 
 private:
+  // Feedback routing a mono or stereo kernel is compiled for. Any blends both by
+  // pingPongMix, which covers every mode and mode change.
+  enum class Topology { Independent, PingPong, Any };
+
+  // What a mono or stereo run is specialised on besides the read. Steady runs drop the LFO
+  // when the modulation depth is zero and the filter while it is inactive (both are advanced
+  // once per run instead, so they resume in step). The general path has everything compiled
+  // in and also handles crossfades, the fade-in and mode changes; these transitions are short,
+  // so they share the one instantiation.
+  template <Topology T, bool Modulated, bool Filtered>
+  struct RunPath {
+    static constexpr Topology topology = T;
+    static constexpr bool modulated = Modulated;
+    static constexpr bool filtered = Filtered;
+    static constexpr bool general = T == Topology::Any;
+  };
+  using GeneralPath = RunPath<Topology::Any, true, true>;
+
+  // Calls `fn` with the RunPath for the next run, chosen from the current settings; mono runs
+  // (Topologies false) always take the Independent variants
+  template <bool Topologies, typename Fn>
+  void dispatchPath(bool general, Fn&& fn);
+
+  // Kernels over a run of samples, specialised on the buffers' sample type, the
+  // interpolation policy, the line's storage format and the RunPath; crossfade runs read the
+  // fading-out head as well
+  template <typename Sample, typename Interp, typename Format, typename Path>
+  void processMonoRun(Sample* samples, int numSamples);
+  template <typename Sample, typename Interp, typename Format, typename Path>
+  void processStereoScalarRun(Sample* left, Sample* right, int numSamples);
+  template <typename Sample, typename Interp, typename Format, typename Path>
+  void processStereoSimdRun(Sample* left, Sample* right, int numSamples);
+  template <typename Sample, typename Interp, typename Format, bool Crossfade>
+  void processMultichannelRun(Sample* const* channels, int start, int numSamples);
+  template <typename Sample, typename Interp, typename Format, bool Crossfade>
+  void processNetworkRun(Sample* left, Sample* right, int numSamples);
+
+  // LFO and filter steps a run without them skips
+  template <typename Path>
+  void advanceDroppedStages(int numSamples) {
+    if constexpr (!Path::modulated)
+      lfo.advance(numSamples);
+    if constexpr (!Path::filtered)
+      filter.skip(numSamples);
+  }
+
+  // Adds the taps to a run the kernel has just processed and written, see processTapsRun
+  template <typename Sample, typename Interp, typename Format>
+  void processTapsRun(Sample* left, Sample* right, int numSamples);
+
+  // Reads one channel `delaySamples` behind the write head, in the format's Real precision
+  template <typename Interp, typename Format>
+  typename Format::Real read(float delaySamples,
+                             size_t channel,
+                             typename Format::Real& state) const;
+
+  // Allpass state of a scalar kernel's read, in the precision it computes in
+  template <typename Real>
+  Real& getAllpassState(size_t head, size_t channel) {
+    if constexpr (std::is_same_v<Real, double>)
+      return preciseAllpassState[head][channel];
+    else
+      return allpassState[head][channel];
+  }
+
+  // Reads lanes `firstLane` .. `firstLane + 3`, each `delays[l]` behind the write head with
+  // its own weights; `state` is their allpass state
+  template <typename Interp, typename Format>
+  simd::Float4 readLanes(const float* delays, size_t firstLane, float* state) const;
+
+  // Calls `fn` with the current interpolation policy and the line's format
+  template <typename Fn>
+  void dispatch(Fn&& fn) {
+    interpolation::dispatch(interpolation, [&](auto policy) {
+      sample_format::dispatch(delayLine->getFormat(),
+                              [&](auto format) { fn(policy, format); });
+    });
+  }
+
+  // The line, typed as the format the running kernel was instantiated for
+  template <typename Format>
+  FormattedDelayLine<Format>& getLine() {
+    return static_cast<FormattedDelayLine<Format>&>(*delayLine);
+  }
+  template <typename Format>
+  const FormattedDelayLine<Format>& getLine() const {
+    return static_cast<const FormattedDelayLine<Format>&>(*delayLine);
+  }
+
+  void adoptPendingDelayLine(int numSamples);
+
+  // Lanes of a new line, of the network's layout or not
+  size_t getLineLanes(bool network) const {
+    return network && numChannels <= 2 ? networkLines : numLanes;
+  }
+
+  // True while the line holds the network's lanes rather than L/R frames
+  bool isNetworkLine() const {
+    return numChannels <= 2 && delayLine->getNumChannels() == networkLines;
+  }
+
+  // Tracks the input level; returns true (with the dry gain applied) when the block needs
+  // no processing because both the input and the repeats are silent
+  template <typename Sample>
+  bool skipIfIdle(Sample* const* channels, int numChannelsToCheck, int numSamples);
+
+  // Samples after the input stops until repeats of `level` are below silenceThreshold
+  size_t getDecaySamples(float level) const;
+
+  // Hands the allpass state over to the fading-out head when a crossfade starts
+  void beginRun();
+
+  // Flips the ping-pong side once per repeat
+  void stepPingPong(float delaySamples) {
+    if (--samplesUntilNextFlip <= 0) {
+      pingPongFlip = !pingPongFlip;
+      samplesUntilNextFlip = static_cast<size_t>(std::max(delaySamples, 1.0f));
+    }
+  }
+
+  // Length of the next run that is entirely inside or outside a crossfade, and short
+  // enough for the taps to read it back
+  int getRunLength(int numSamples) const {
+    if (numTapGroups > 0)
+      numSamples = std::min(numSamples, tapRunLength);
+    return readHeads.isCrossfading() ? std::min(numSamples, readHeads.getCrossfadeSamplesLeft())
+                                     : numSamples;
+  }
+
   double sampleRate;
-  const double maxDelayTime;
+  double maxDelayTime = 2.0;
+
+  // Ramp length applied to level, feedback and modulation depth changes
+  static constexpr double smoothingTimeSeconds = 0.05;
+  bool snapToTargets = true;
 
-  float delayTimeSeconds;
-  float feedback;
-  float wetLevel;
-  float dryLevel;
+  float delayTimeSeconds = 0.0f;
+  ReadHeads readHeads;
 
-  float hiCutFreq;
-  juce::dsp::IIR::Filter<float> hiCutFilterL;
-  juce::dsp::IIR::Filter<float> hiCutFilterR;
-  juce::dsp::IIR::Coefficients<float>::Ptr hiCutCoefficients;
+  Interpolation interpolation = Interpolation::Linear;
+  float allpassState[2][maxChannels] = {};  // [main/previous head][channel]
+  double preciseAllpassState[2][2] = {};     // of the scalar kernels on a Float64 line
 
-  float modDepth;
-  float modRate;
-  float modPhase;
+  juce::SmoothedValue<float> feedback{0.0f};
+  juce::SmoothedValue<float> wetLevel{0.0f};
+  juce::SmoothedValue<float> dryLevel{1.0f};
+
+  FeedbackFilter filter;  // one state per channel or lane
+
+  Lfo lfo;
+  juce::SmoothedValue<float> modDepth{0.0f};  // in seconds
+  bool wideModulation = false;
 
   float fadeInAmount = 0.0f;
   float fadeInIncrement = 0.0f;
@@ -57,8 +322,60 @@ private:
   bool pingPongFlip = false;
   size_t samplesUntilNextFlip = 1;
 
-  DelayMode mode;
+  // Feedback routing between the independent (0) and ping-pong (1) topologies. A mode change
+  // ramps it over modeChangeSeconds, writing a blend of both into the line; see
+  // processStereoScalarRun
+  static constexpr double modeChangeSeconds = 0.05;
+  juce::SmoothedValue<float> pingPongMix{0.0f};
+
+  // Diffuse mode: lines of the network, each a lane of the line reading at its own fraction
+  // of the delay time. Diffusion blends the feedback matrix and the outputs from the plain
+  // L/R lanes (0) to the full network (1), over modeChangeSeconds.
+  static constexpr size_t networkLines = 4;
+  bool networkLayout = false;
+  juce::SmoothedValue<float> diffusion{0.0f};
+  // How much shorter each line is than the delay time, in samples: ramped to a new delay
+  // time, then whole samples (settled, and shared when not ramping)
+  std::array<juce::SmoothedValue<float>, networkLines> networkOffsets;
+  std::array<size_t, networkLines> networkShortening{};
+  bool networkSharedFraction = true;
+
+  // Multi-tap: ramps (in samples, and gains per output side) followed once per run, in
+  // groups of four taps up to the last one that is audible or fading out
+  static constexpr int tapRunLength = 64;
+  static constexpr double tapGlideSeconds = 0.1;
+  // Filter states of the summed taps, past the lanes the stereo kernels and the network use
+  static constexpr size_t tapFilterChannel = networkLines;
+  std::array<juce::SmoothedValue<float>, maxTaps> tapDelays;
+  juce::SmoothedValue<float> tapGains[2][maxTaps];
+  float tapAllpassState[2][maxTaps] = {};
+  size_t numTapGroups = 0;
+
+  DelayMode mode = DelayMode::Stereo;
+  Kernel kernel = Kernel::Simd;
+
+  // Multichannel frames are padded to whole registers of four channels (lanes)
+  int numChannels = 2;
+  size_t numLanes = 2;
+
+  std::array<juce::SmoothedValue<float>, maxChannels> channelOffsets;  // in samples
+  std::array<size_t, maxChannels> laneOffsets{};  // settled offsets, in whole samples
+  bool sharedFraction = true;  // lanes differ by whole samples only
+  bool uniformLanes = true;    // every lane reads the same position
+
+  // Interleaved frames (L/R, or one lane per channel), so one load fetches several channels
+  StorageFormat storageFormat = StorageFormat::Float32;
+  std::unique_ptr<DelayLine> delayLine;
+  size_t readReach = 0;  // oldest frame the current settings can read
+
+  std::atomic<DelayLine*> pendingLine{nullptr};  // submitted, not yet swapped in
+  std::atomic<DelayLine*> retiredLine{nullptr};  // swapped out, waiting to be freed
+  DelayLine* incomingLine = nullptr;  // from pendingLine, catching up or waiting for a layout
 
-  std::vector<float> delayBuffer[2];
-  size_t writeIndex;
+  // Idle detection: while idle nothing advances, so the line, filters and ramps resume
+  // exactly where they stopped, with repeats already below silenceThreshold
+  float inputPeak = 0.0f;  // loudest input since the last idle period
+  size_t silentSamples = 0;
+  bool idle = false;
+  double tailSeconds = 0.0;
 };
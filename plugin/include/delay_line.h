@@ -0,0 +1,202 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include "sample_format.h"
+
+/**
+ * Ring buffer of interleaved frames with power-of-two length.
+ *
+ * Indices wrap with a mask instead of a modulo, and the first `guardFrames` frames are
+ * mirrored past the end of the storage. A read of up to `guardFrames + 1` neighbouring
+ * frames starting at any position is therefore one contiguous block of memory, so
+ * interpolators never have to handle wrap-around.
+ *
+ * Re-preparing with the same size keeps the storage and only marks it stale rather than
+ * clearing the whole (possibly many seconds long) buffer up front. The audio thread then
+ * zeroes a bounded amount per block with cleanAhead(), and readers clamp to
+ * getReadableDelay(), so until the zeroing gets to them they hear silence, not old audio.
+ * A line swapped in while processing takes the running line's history over in bounded parts
+ * too (copyHistory()), while the running line is still being read and written.
+ *
+ * This base class does the bookkeeping; FormattedDelayLine holds the samples in one of
+ * the sample_format types and gives the kernels typed access.
+ */
+class DelayLine {
+public:
+  static constexpr size_t guardFrames = 4;
+  static constexpr size_t maxChannels = 16;
+  // Zeroed by each cleanAhead(), about a memset of a few microseconds
+  static constexpr size_t cleanBytesPerCall = 64 * 1024;
+
+  virtual ~DelayLine() = default;
+
+  // Makes room for at least `minDelayFrames` frames of delay, allocating (zeroed) storage
+  // only when the size changes
+  void prepare(size_t minDelayFrames, size_t newNumChannels);
+  void clear();
+
+  // Zeroes any stale frame up to `delay` frames behind the write head, however many that is
+  void ensureClean(size_t delay);
+
+  // Zeroes up to cleanBytesPerCall of the stale frames nearest the write head; bounded, so
+  // it can run once per block on the audio thread
+  void cleanAhead();
+
+  // Starts taking over the newest `frames` frames of `other` (any format), which goes on being
+  // written meanwhile. Channels past the ones both lines have are left silent.
+  void beginHistoryFrom(const DelayLine& other, size_t frames);
+
+  // Copies the next part of that history, cleanBytesPerCall's worth but at least `minFrames`
+  // frames (above the block length, so it gains on `other`). Returns true once it has caught
+  // up with `other`'s write head, where this line then carries on from; until it is written
+  // to, later calls keep it caught up. Bounded, so it can run once per block on the audio
+  // thread.
+  bool copyHistory(size_t minFrames);
+
+  sample_format::Type getFormat() const { return format; }
+  size_t getNumChannels() const { return numChannels; }
+  size_t getSizeInBytes() const { return (length + guardFrames) * numChannels * sampleSize; }
+
+  // Delay (in frames) the line was last prepared for; getMaxDelay() is that rounded up
+  size_t getPreparedDelay() const { return preparedDelay; }
+
+  // Longest delay (in frames) that still leaves `guardFrames` of headroom for readers
+  size_t getMaxDelay() const { return length - guardFrames - 1; }
+
+  // Longest delay (in frames) whose neighbourhood holds no stale frames; readers clamp to this
+  // rather than getMaxDelay(). Never shorter than the shortest delay an interpolator reads.
+  size_t getReadableDelay() const {
+    return std::clamp(cleanFrames, 2 * guardFrames, getMaxDelay());
+  }
+
+  // Frame written `delay` frames ago as floats; zeros where the line is stale or too short
+  void readFrameAt(size_t delay, float* out) const;
+
+protected:
+  DelayLine(sample_format::Type newFormat, size_t newSampleSize)
+      : format(newFormat), sampleSize(newSampleSize) {}
+
+  size_t getIndex(size_t delay) const { return (writeIndex - delay) & mask; }
+
+  // Storage, by frame index: zeroed (re)allocation, zeroing a range, reading as float and
+  // copying a frame from a line of any format and width (exact when the formats match)
+  virtual void allocate(size_t numFrames) = 0;
+  virtual void zeroFrames(size_t first, size_t count) = 0;
+  virtual void readFrame(size_t index, float* out) const = 0;
+  virtual void copyFrame(const DelayLine& from, size_t fromIndex, size_t toIndex) = 0;
+
+  // Zeroes the `count` stale frames following the clean ones
+  void zeroStaleFrames(size_t count);
+
+  // Copies the first `guardFrames` frames past the end
+  void refreshGuard() {
+    for (size_t i = 0; i < guardFrames; ++i)
+      copyFrame(*this, i, length + i);
+  }
+
+  template <typename>
+  friend class FormattedDelayLine;
+
+  const sample_format::Type format;
+  const size_t sampleSize;
+
+  size_t numChannels = 0;
+  size_t length = 0;  // in frames, power of two
+  size_t mask = 0;
+  size_t writeIndex = 0;
+  size_t cleanFrames = 0;  // frames behind the write head that are zero or written since
+  size_t preparedDelay = 0;
+  size_t framesWritten = 0;  // since prepare(); writeIndex is this wrapped
+
+  // History being taken over: frames `historyStart` .. `historyEnd` (counted as
+  // `framesWritten`) of `historySource` are in place
+  const DelayLine* historySource = nullptr;
+  size_t historyStart = 0;
+  size_t historyEnd = 0;
+  bool historyOverZeros = false;  // the frames around it were never written
+};
+
+template <typename Format>
+class FormattedDelayLine final : public DelayLine {
+public:
+  using Sample = typename Format::Sample;
+
+  FormattedDelayLine() : DelayLine(formatOf(), sizeof(Sample)) {}
+
+  // Frame written `delay` frames ago; the newer frames following it are contiguous
+  const Sample* getFrame(size_t delay) const {
+    return data.data() + getIndex(delay) * numChannels;
+  }
+
+  // Frame at the write head, valid until advance() is called
+  Sample* getWriteFrame() { return data.data() + writeIndex * numChannels; }
+
+  // Noise for converting writes to Int16
+  sample_format::Dither& getDither() { return dither; }
+
+  // Commits the frame at the write head and moves to the next one
+  void advance() {
+    if (writeIndex < guardFrames) {
+      const Sample* src = getWriteFrame();
+      Sample* mirror = data.data() + (length + writeIndex) * numChannels;
+      for (size_t c = 0; c < numChannels; ++c)
+        mirror[c] = src[c];
+    }
+    writeIndex = (writeIndex + 1) & mask;
+    ++framesWritten;
+    if (cleanFrames < length)
+      ++cleanFrames;
+  }
+
+private:
+  static constexpr sample_format::Type formatOf() {
+    if constexpr (std::is_same_v<Format, sample_format::Float16>)
+      return sample_format::Type::Float16;
+    else if constexpr (std::is_same_v<Format, sample_format::Int16>)
+      return sample_format::Type::Int16;
+    else if constexpr (std::is_same_v<Format, sample_format::Float64>)
+      return sample_format::Type::Float64;
+    else
+      return sample_format::Type::Float32;
+  }
+
+  void allocate(size_t numFrames) override { data.assign(numFrames * numChannels, Sample{}); }
+
+  void zeroFrames(size_t first, size_t count) override {
+    std::fill_n(data.begin() + static_cast<std::ptrdiff_t>(first * numChannels),
+                count * numChannels, Sample{});
+  }
+
+  void readFrame(size_t index, float* out) const override {
+    for (size_t c = 0; c < numChannels; ++c)
+      out[c] = Format::toFloat(data[index * numChannels + c]);
+  }
+
+  void copyFrame(const DelayLine& from, size_t fromIndex, size_t toIndex) override {
+    Sample* dst = data.data() + toIndex * numChannels;
+
+    const size_t common = std::min(numChannels, from.numChannels);
+
+    if (from.format == format) {
+      const auto& same = static_cast<const FormattedDelayLine&>(from);
+      std::copy_n(same.data.data() + fromIndex * from.numChannels, common, dst);
+    } else {
+      float frame[maxChannels];
+      from.readFrame(fromIndex, frame);
+      for (size_t c = 0; c < common; ++c)
+        dst[c] = Format::fromFloat(frame[c], dither);
+    }
+
+    std::fill(dst + common, dst + numChannels, Sample{});
+  }
+
+  std::vector<Sample> data;
+  sample_format::Dither dither;
+};
+
+// An empty (unprepared) line storing samples as `format`
+std::unique_ptr<DelayLine> makeDelayLine(sample_format::Type format);
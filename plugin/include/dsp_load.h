@@ -0,0 +1,102 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * How long processBlock takes compared to the time the host gives it: the duration of the
+ * block in samples. Only built with ENABLE_DSP_LOAD, see plugin/CMakeLists.txt.
+ *
+ * The audio thread is the only writer. Every field is a relaxed atomic that it loads and
+ * stores without read-modify-write, so recording a block costs two clock reads and a
+ * handful of plain stores; readers on other threads may see a block half recorded, which
+ * is fine for statistics. Loads are binned in a histogram of `binsPerDeadline` bins per
+ * deadline, up to twice the deadline, from which the 99th percentile is read.
+ */
+class DspLoad {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr int binsPerDeadline = 100;
+  static constexpr int numBins = 2 * binsPerDeadline + 1;  // the last one collects overruns
+
+  // Blocks using more of their deadline than this are counted as at risk of an xrun: the
+  // host, the driver and other plugins need the rest
+  static constexpr float xrunRiskLoad = 0.8f;
+
+  struct Stats {
+    uint64_t numBlocks = 0;
+    double meanMicroseconds = 0.0;
+    double maxMicroseconds = 0.0;
+
+    // Fractions of the block deadline
+    double meanLoad = 0.0;
+    double p99Load = 0.0;
+    double maxLoad = 0.0;
+
+    uint64_t xrunRiskBlocks = 0;
+
+    juce::String toString() const;
+    juce::var toVar() const;
+  };
+
+  // Times its own lifetime as one block of `numSamples`
+  class ScopedMeasurement {
+  public:
+    ScopedMeasurement(DspLoad& owner, int numSamples)
+        : load(owner), samples(numSamples), start(Clock::now()) {}
+    ~ScopedMeasurement() { load.record(Clock::now() - start, samples); }
+
+    ScopedMeasurement(const ScopedMeasurement&) = delete;
+    ScopedMeasurement& operator=(const ScopedMeasurement&) = delete;
+
+  private:
+    DspLoad& load;
+    int samples;
+    Clock::time_point start;
+  };
+
+  // Clears the statistics; not while blocks are being recorded
+  void prepare(double sampleRate);
+
+  // Audio thread only
+  void record(Clock::duration elapsed, int numSamples);
+
+  // Any thread
+  Stats getStats() const;
+
+private:
+  template <typename T>
+  static void add(std::atomic<T>& counter, T amount) {
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+  }
+
+  double nanosecondsPerSample = 1.0e9 / 44100.0;
+
+  std::atomic<uint64_t> numBlocks{0};
+  std::atomic<uint64_t> totalNanoseconds{0};
+  std::atomic<uint64_t> totalDeadlineNanoseconds{0};
+  std::atomic<uint64_t> maxNanoseconds{0};
+  std::atomic<float> maxLoad{0.0f};
+  std::atomic<uint64_t> xrunRiskBlocks{0};
+  std::array<std::atomic<uint32_t>, numBins> bins{};
+};
+
+/**
+ * Writes the statistics of a DspLoad to the JUCE log every `intervalMs` from its own thread,
+ * for headless builds where there is no UI to show them. Stops with its destructor.
+ */
+class DspLoadLogger : private juce::Thread {
+public:
+  DspLoadLogger(const DspLoad& loadToLog, int intervalMs);
+  ~DspLoadLogger() override;
+
+private:
+  void run() override;
+
+  const DspLoad& load;
+  const int interval;
+};
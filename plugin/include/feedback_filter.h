@@ -0,0 +1,152 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <cstddef>
+#include <type_traits>
+#include "simd.h"
+
+/**
+ * Tone shaping of the delayed signal: a Butterworth low-pass (hi-cut) of 12, 24 or 48 dB/oct
+ * and an optional 12 dB/oct Butterworth high-pass (low-cut) that keeps low end from building
+ * up in the repeats. Each is a cascade of biquads in transposed direct form II, with one
+ * state per section and channel.
+ *
+ * The coefficients are plain members computed in place, so moving a cutoff never
+ * allocates or frees anything on the audio thread. A new cutoff is approached on a
+ * logarithmic ramp that advances once every `updateInterval` samples, and the
+ * coefficients are recomputed at each of those steps only, which keeps automation free
+ * of zipper noise at the cost of one tan() per cutoff and sub-block while ramping.
+ *
+ * The vector process() runs the whole cascade for four channels at once, so stereo takes
+ * one pass through the sections for both channels (two lanes idle) rather than one scalar
+ * pass per channel. The scalar process() also runs in double precision, with a state of its
+ * own, for delay lines that keep the repeats in doubles.
+ */
+class FeedbackFilter {
+public:
+  static constexpr size_t maxChannels = 16;
+  static constexpr int updateInterval = 32;
+
+  enum class Slope { dB12, dB24, dB48 };
+
+  // Resets the state and recomputes the coefficients of the current cutoffs for the new rate
+  void prepare(double newSampleRate, double rampSeconds);
+  void reset();
+
+  // Cutoffs outside 20 Hz .. Nyquist leave the hi-cut as it is; until a valid one arrives it
+  // passes the signal through. The first valid cutoff is applied at once, later ones ramp.
+  void setCutoff(float hz);
+
+  // A change of slope adds or removes sections at once; added ones start from silence
+  void setSlope(Slope newSlope);
+
+  // As setCutoff, except that a cutoff outside the range turns the low-cut off
+  void setLowCut(float hz);
+
+  // Ends the ramps at their targets
+  void snapToCutoff();
+
+  // Moves on to the next frame; call once per frame before processing its channels
+  void tick() {
+    if (--samplesUntilUpdate <= 0)
+      update();
+  }
+
+  // Moves on by `numSamples` frames, as that many tick() calls would
+  void skip(int numSamples);
+
+  // False while both filters pass the signal through (process() may then be skipped)
+  bool isActive() const { return numSections > 0; }
+
+  // One channel, in float or double precision
+  template <typename Real>
+  Real process(Real x, size_t channel) {
+    for (size_t k = 0; k < numSections; ++k) {
+      const size_t s = sections[k];
+      const auto& c = coefficients[s];
+      Real* s1 = getState1<Real>(s);
+      Real* s2 = getState2<Real>(s);
+      Real y = c.b0 * x + s1[channel];
+      s1[channel] = c.b1 * x - c.a1 * y + s2[channel];
+      s2[channel] = c.b2 * x - c.a2 * y;
+      x = y;
+    }
+    return x;
+  }
+
+  // Channels `firstChannel` .. `firstChannel + 3` at once
+  simd::Float4 process(simd::Float4 x, size_t firstChannel) {
+    using simd::Float4;
+    for (size_t k = 0; k < numSections; ++k) {
+      const size_t s = sections[k];
+      const auto& c = coefficients[s];
+      float* s1 = state1[s] + firstChannel;
+      float* s2 = state2[s] + firstChannel;
+      Float4 y = Float4{c.b0} * x + Float4::load(s1);
+      (Float4{c.b1} * x - Float4{c.a1} * y + Float4::load(s2)).store(s1);
+      (Float4{c.b2} * x - Float4{c.a2} * y).store(s2);
+      x = y;
+    }
+    return x;
+  }
+
+  // Hands the state of one precision's scalar process() to the other's, for a line of the
+  // other precision taking over
+  void copyState(bool toDouble);
+
+private:
+  // The low-cut, then the sections of the 48 dB/oct hi-cut. Each keeps its slot while
+  // others are switched on or off, so no state moves between sections.
+  static constexpr size_t lowCutSection = 0;
+  static constexpr size_t firstHiCutSection = 1;
+  static constexpr size_t maxSections = 5;
+
+  struct Coefficients {
+    float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f, a1 = 0.0f, a2 = 0.0f;
+  };
+
+  using Cutoff = juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative>;
+
+  template <typename Real>
+  Real* getState1(size_t section) {
+    if constexpr (std::is_same_v<Real, double>)
+      return preciseState1[section];
+    else
+      return state1[section];
+  }
+  template <typename Real>
+  Real* getState2(size_t section) {
+    if constexpr (std::is_same_v<Real, double>)
+      return preciseState2[section];
+    else
+      return state2[section];
+  }
+
+  void clearSection(size_t section);
+  void update();
+  void updateSections();
+  void computeHiCut(float hz);
+  void computeLowCut(float hz);
+  bool isValidCutoff(float hz) const { return hz > 20.0f && hz < sampleRate * 0.5; }
+
+  double sampleRate = 44100.0;
+
+  // Steps once per update interval
+  Cutoff cutoff{1000.0f};
+  Cutoff lowCutoff{20.0f};
+  int samplesUntilUpdate = 0;
+
+  bool hiCutActive = false;
+  bool lowCutActive = false;
+  Slope slope = Slope::dB12;
+
+  // Slots processed, in order
+  size_t sections[maxSections] = {};
+  size_t numSections = 0;
+
+  Coefficients coefficients[maxSections];
+  float state1[maxSections][maxChannels] = {};
+  float state2[maxSections][maxChannels] = {};
+  double preciseState1[maxSections][maxChannels] = {};
+  double preciseState2[maxSections][maxChannels] = {};
+};
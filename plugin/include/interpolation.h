@@ -0,0 +1,122 @@
+#pragma once
+
+/**
+ * Fractional-delay interpolation policies for the delay kernels.
+ *
+ * A delay of `whole + frac` samples lies between frame f0 (whole + 1 samples old) and
+ * f1 (whole samples old), at t = 1 - frac from f0. A policy reads `taps` consecutive
+ * frames starting at f[firstTap] and combines them with the weights written by
+ * `weights(t, w)`. The return value is the coefficient of the policy's recursion on its
+ * own previous output (only the allpass uses one, see `recursive`).
+ */
+namespace interpolation {
+enum class Type { None, Linear, Hermite, Lagrange, Allpass };
+
+// Truncates to f1, i.e. the integer delay
+struct None {
+  static constexpr int taps = 1;
+  static constexpr int firstTap = 1;
+  static constexpr bool recursive = false;
+
+  static float weights(float, float* w) {
+    w[0] = 1.0f;
+    return 0.0f;
+  }
+};
+
+struct Linear {
+  static constexpr int taps = 2;
+  static constexpr int firstTap = 0;
+  static constexpr bool recursive = false;
+
+  static float weights(float t, float* w) {
+    w[0] = 1.0f - t;
+    w[1] = t;
+    return 0.0f;
+  }
+};
+
+// 4-point cubic Hermite (Catmull-Rom) over f[-1]..f2
+struct Hermite {
+  static constexpr int taps = 4;
+  static constexpr int firstTap = -1;
+  static constexpr bool recursive = false;
+
+  static float weights(float t, float* w) {
+    const float t2 = t * t;
+    const float t3 = t2 * t;
+    w[0] = -0.5f * t + t2 - 0.5f * t3;
+    w[1] = 1.0f - 2.5f * t2 + 1.5f * t3;
+    w[2] = 0.5f * t + 2.0f * t2 - 1.5f * t3;
+    w[3] = -0.5f * t2 + 0.5f * t3;
+    return 0.0f;
+  }
+};
+
+// 4-point (third order) Lagrange over f[-1]..f2
+struct Lagrange {
+  static constexpr int taps = 4;
+  static constexpr int firstTap = -1;
+  static constexpr bool recursive = false;
+
+  static float weights(float t, float* w) {
+    const float tp1 = t + 1.0f;
+    const float tm1 = t - 1.0f;
+    const float tm2 = t - 2.0f;
+    w[0] = -t * tm1 * tm2 * (1.0f / 6.0f);
+    w[1] = tp1 * tm1 * tm2 * 0.5f;
+    w[2] = -tp1 * t * tm2 * 0.5f;
+    w[3] = tp1 * t * tm1 * (1.0f / 6.0f);
+    return 0.0f;
+  }
+};
+
+// First-order allpass (Thiran): y = eta * x[M] + x[M + 1] - eta * y[-1], with the
+// fractional part kept in [0.5, 1.5) where the filter is best behaved
+struct Allpass {
+  static constexpr int taps = 3;
+  static constexpr int firstTap = 0;
+  static constexpr bool recursive = true;
+
+  static float weights(float t, float* w) {
+    const float frac = 1.0f - t;
+
+    if (frac >= 0.5f) {
+      const float eta = (1.0f - frac) / (1.0f + frac);
+      w[0] = 1.0f;
+      w[1] = eta;
+      w[2] = 0.0f;
+      return eta;
+    }
+
+    const float eta = -frac / (2.0f + frac);
+    w[0] = 0.0f;
+    w[1] = 1.0f;
+    w[2] = eta;
+    return eta;
+  }
+};
+
+// Calls `fn` with a default-constructed policy object matching `type`
+template <typename Fn>
+void dispatch(Type type, Fn&& fn) {
+  switch (type) {
+    case Type::None:
+      fn(None{});
+      break;
+    case Type::Hermite:
+      fn(Hermite{});
+      break;
+    case Type::Lagrange:
+      fn(Lagrange{});
+      break;
+    case Type::Allpass:
+      fn(Allpass{});
+      break;
+    case Type::Linear:
+    default:
+      fn(Linear{});
+      break;
+  }
+}
+}  // namespace interpolation
@@ -0,0 +1,67 @@
+#pragma once
+
+/**
+ * Sine LFO for the delay-time modulation.
+ *
+ * A recursive quadrature oscillator (a rotating sin/cos pair) is stepped once every
+ * `controlInterval` samples and linearly interpolated in between, so the audio loop adds
+ * one increment per sample instead of calling std::sin and std::fmod. A second output at
+ * a fixed phase offset is derived from the same pair by rotation, which gives stereo
+ * modulation without a second oscillator. Nothing here allocates.
+ */
+class Lfo {
+public:
+  static constexpr int controlInterval = 16;
+
+  void setSampleRate(double newSampleRate);
+  void setFrequency(float newFrequencyHz);
+  void setPhaseOffset(float newOffsetCycles);  // of the second output, 0..1
+  void reset();
+
+  // Advances one sample and returns sin(phase)
+  float next() {
+    if (samplesUntilUpdate == 0)
+      updateControlPoint();
+    --samplesUntilUpdate;
+
+    float out = value;
+    value += step;
+    offsetValue += offsetStep;
+    return out;
+  }
+
+  // Advances one sample and returns sin(phase) and sin(phase + offset)
+  void next(float& out, float& offsetOut) {
+    offsetOut = offsetValue;
+    out = next();
+  }
+
+  // Advances `numSamples` as that many calls to next() would, without the outputs
+  void advance(int numSamples);
+
+private:
+  void updateControlPoint();
+  void updateRotation();
+
+  double sampleRate = 44100.0;
+  float frequencyHz = 0.0f;
+  float offsetCycles = 0.0f;
+
+  // Oscillator state at the last control point
+  float sinValue = 0.0f;
+  float cosValue = 1.0f;
+
+  // Rotation applied per control interval
+  float rotationCos = 1.0f;
+  float rotationSin = 0.0f;
+
+  float offsetCos = 1.0f;
+  float offsetSin = 0.0f;
+
+  // Interpolated per-sample outputs
+  float value = 0.0f;
+  float step = 0.0f;
+  float offsetValue = 0.0f;
+  float offsetStep = 0.0f;
+  int samplesUntilUpdate = 0;
+};
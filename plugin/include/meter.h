@@ -0,0 +1,55 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include "delay.h"
+
+/**
+ * Output and repeat levels for the editor, handed from the audio thread to the message
+ * thread through a wait-free single-producer, single-consumer FIFO (juce::AbstractFifo).
+ *
+ * process() accumulates the peak and mean square of every output channel and pushes one
+ * Frame per `1 / framesPerSecond`, with the repeat levels from Delay::getRepeatLevels.
+ * Frames are copied into storage the FIFO owns, so the audio thread never allocates; when
+ * the FIFO is full because no editor is draining it, new frames are dropped instead of
+ * waiting for room.
+ */
+class Meter {
+public:
+  static constexpr int maxChannels = Delay::maxChannels;
+  static constexpr int numRepeats = 8;
+  static constexpr double framesPerSecond = 30.0;
+
+  // Frames held; the FIFO keeps one slot free, so about a second's worth is queued
+  static constexpr int capacity = 32;
+
+  struct Frame {
+    int numChannels = 0;
+    std::array<float, maxChannels> peak{};
+    std::array<float, maxChannels> rms{};
+    std::array<float, numRepeats> repeatLevels{};
+  };
+
+  // Restarts the running frame; not while processing. Queued frames are left to the reader.
+  void prepare(double sampleRate);
+
+  // Audio thread: the output of a block of float or double samples, after `delay` processed it
+  template <typename Sample>
+  void process(const Sample* const* channels, int numChannels, int numSamples, const Delay& delay);
+
+  // Message thread: moves up to `maxFrames` queued frames, oldest first, into `frames`
+  int pop(Frame* frames, int maxFrames);
+
+private:
+  void push(const Delay& delay);
+
+  juce::AbstractFifo fifo{capacity};
+  std::array<Frame, capacity> queue;
+
+  // The frame being accumulated
+  int frameSamples = 1470;
+  int samplesInFrame = 0;
+  int numFrameChannels = 0;
+  std::array<float, maxChannels> peak{};
+  std::array<float, maxChannels> sumOfSquares{};
+};
@@ -13,7 +13,7 @@ struct SinglePageBrowser : juce::WebBrowserComponent {
 };
 
 namespace audio_plugin {
-class AudioPluginAudioProcessorEditor : public juce::AudioProcessorEditor {
+class AudioPluginAudioProcessorEditor : public juce::AudioProcessorEditor, private juce::Timer {
 public:
   explicit AudioPluginAudioProcessorEditor(AudioPluginAudioProcessor&);
   ~AudioPluginAudioProcessorEditor() override;
@@ -26,7 +26,11 @@ public:
   }
 
 private:
+  // Sends the meter frames queued since the last tick to the WebView as one "meters" event
+  void timerCallback() override;
+
   AudioPluginAudioProcessor& processorRef;
+  std::array<Meter::Frame, Meter::capacity> meterFrames;
 
   //==============================================================================
   // WebView UI
@@ -41,10 +45,20 @@ private:
   juce::WebSliderRelay dryRelay{"dryLevel"};
   juce::WebSliderRelay modDepthRelay{"modDepth"};
   juce::WebSliderRelay modRateRelay{"modRate"};
+  juce::WebSliderRelay modWidthRelay{"modWidth"};
   juce::WebToggleButtonRelay sync{"sync"};
   juce::WebComboBoxRelay divisionRelay{"division"};
   juce::WebComboBoxRelay modeRelay{"mode"};
   juce::WebSliderRelay hiCutFreqRelay{"hiCutFreq"};
+  juce::WebComboBoxRelay hiCutSlopeRelay{"hiCutSlope"};
+  juce::WebSliderRelay lowCutFreqRelay{"lowCutFreq"};
+  juce::WebComboBoxRelay timeModeRelay{"timeMode"};
+  juce::WebSliderRelay timeChangeTimeRelay{"timeChangeTime"};
+  juce::WebComboBoxRelay interpolationRelay{"interpolation"};
+  juce::WebComboBoxRelay maxDelayRelay{"maxDelay"};
+  juce::WebComboBoxRelay storageRelay{"storage"};
+  juce::WebToggleButtonRelay channelLinkRelay{"channelLink"};
+  juce::WebSliderRelay channelSpreadRelay{"channelSpread"};
 
   juce::WebSliderParameterAttachment delayTimeWebAttachment{
       *processorRef.parameters.getParameter("delayTime"), delayTimeRelay, nullptr};
@@ -58,6 +72,8 @@ private:
       *processorRef.parameters.getParameter("modDepth"), modDepthRelay, nullptr};
   juce::WebSliderParameterAttachment modRateWebAttachment{
       *processorRef.parameters.getParameter("modRate"), modRateRelay, nullptr};
+  juce::WebSliderParameterAttachment modWidthWebAttachment{
+      *processorRef.parameters.getParameter("modWidth"), modWidthRelay, nullptr};
   juce::WebToggleButtonParameterAttachment syncWebAttachment{
       *processorRef.parameters.getParameter("sync"), sync, nullptr};
   juce::WebComboBoxParameterAttachment divisionWebAttachment{
@@ -66,6 +82,31 @@ private:
       *processorRef.parameters.getParameter("mode"), modeRelay, nullptr};
   juce::WebSliderParameterAttachment hiCutWebAttachment{
       *processorRef.parameters.getParameter("hiCutFreq"), hiCutFreqRelay, nullptr};
+  juce::WebComboBoxParameterAttachment hiCutSlopeWebAttachment{
+      *processorRef.parameters.getParameter("hiCutSlope"), hiCutSlopeRelay, nullptr};
+  juce::WebSliderParameterAttachment lowCutWebAttachment{
+      *processorRef.parameters.getParameter("lowCutFreq"), lowCutFreqRelay, nullptr};
+  juce::WebComboBoxParameterAttachment timeModeWebAttachment{
+      *processorRef.parameters.getParameter("timeMode"), timeModeRelay, nullptr};
+  juce::WebSliderParameterAttachment timeChangeTimeWebAttachment{
+      *processorRef.parameters.getParameter("timeChangeTime"), timeChangeTimeRelay, nullptr};
+  juce::WebComboBoxParameterAttachment interpolationWebAttachment{
+      *processorRef.parameters.getParameter("interpolation"), interpolationRelay, nullptr};
+  juce::WebComboBoxParameterAttachment maxDelayWebAttachment{
+      *processorRef.parameters.getParameter("maxDelay"), maxDelayRelay, nullptr};
+  juce::WebComboBoxParameterAttachment storageWebAttachment{
+      *processorRef.parameters.getParameter("storage"), storageRelay, nullptr};
+  juce::WebToggleButtonParameterAttachment channelLinkWebAttachment{
+      *processorRef.parameters.getParameter("channelLink"), channelLinkRelay, nullptr};
+  juce::WebSliderParameterAttachment channelSpreadWebAttachment{
+      *processorRef.parameters.getParameter("channelSpread"), channelSpreadRelay, nullptr};
+
+  // Per-channel offsets and the multi-tap settings ("channelOffset1".., "taps", "tapTime1"..),
+  // made in the constructor as there is one of each per channel or tap
+  std::vector<std::unique_ptr<juce::WebSliderRelay>> sliderRelays;
+  std::vector<std::unique_ptr<juce::WebComboBoxRelay>> comboBoxRelays;
+  std::vector<std::unique_ptr<juce::WebSliderParameterAttachment>> sliderAttachments;
+  std::vector<std::unique_ptr<juce::WebComboBoxParameterAttachment>> comboBoxAttachments;
 
   std::optional<juce::WebBrowserComponent::Resource> getResource(const juce::String& url);
   juce::String getMimeForExtension(const juce::String& extension);
@@ -100,7 +141,7 @@ private:
   // juce::ComboBox divisionBox;
   // std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> divisionAttachment;
 
-  // // Mode selector (Mono, Stereo, PingPong)
+  // // Mode selector (Mono, Stereo, PingPong, Diffuse)
   // juce::Label modeLabel;
   // juce::ComboBox modeBox;
   // std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> modeAttachment;
@@ -3,9 +3,18 @@
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_gui_basics/juce_gui_basics.h>
 #include "delay.h"
+#include "meter.h"
+
+#if DSP_LOAD
+#include "dsp_load.h"
+#endif
+
+#if CONTROL_SOCKET
+#include "control_server.h"
+#endif
 
 namespace audio_plugin {
-class AudioPluginAudioProcessor : public juce::AudioProcessor {
+class AudioPluginAudioProcessor : public juce::AudioProcessor, private juce::Timer {
 public:
   AudioPluginAudioProcessor();
   ~AudioPluginAudioProcessor() override;
@@ -15,8 +24,11 @@ public:
 
   bool isBusesLayoutSupported(const BusesLayout& layouts) const override;
 
+  // Double buffers are processed in place like float ones, see Delay::processMono. With the
+  // "Float" storage the line is then made of doubles, so the repeats stay in double precision.
   void processBlock(juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
-  using AudioProcessor::processBlock;
+  void processBlock(juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+  bool supportsDoublePrecisionProcessing() const override { return true; }
 
   juce::AudioProcessorEditor* createEditor() override;
   bool hasEditor() const override;
@@ -43,8 +55,143 @@ public:
   // Getters
   juce::AudioProcessorValueTreeState& getParameters() { return parameters; }
 
+  // Presets (message thread), also offered to hosts as programs. Storing under an existing
+  // name replaces that preset; recalling one switches every parameter in the same block.
+  int storePreset(const juce::String& name);
+  bool recallPreset(int index);
+  int getNumPresets() const { return static_cast<int>(presets.size()); }
+  juce::String getPresetName(int index) const;
+
+  // Version written with the state; setStateInformation converts older ones
+  static constexpr int stateVersion = 1;
+
+  // Output and repeat levels, drained by the editor on the message thread
+  Meter& getMeter() { return meter; }
+
+#if DSP_LOAD
+  // processBlock timing since the last prepareToPlay
+  const DspLoad& getDspLoad() const { return dspLoad; }
+#endif
+
+#if CONTROL_SOCKET
+  // Where this instance's control socket listens, or empty when none could be opened
+  juce::String getControlSocketPath() const {
+    return controlServer->isListening() ? controlServer->getPath() : juce::String();
+  }
+#endif
+
 private:
+  void timerCallback() override;
+
+  template <typename Sample>
+  void processSamples(juce::AudioBuffer<Sample>& buffer);
+
+  // Reads the parameters into the delay (audio thread, or prepareToPlay)
+  void applyParameters();
+  double getMaxDelayTimeSetting() const;
+  Delay::StorageFormat getStorageFormatSetting() const;
+  bool getNetworkLayoutSetting() const;  // true in the Diffuse mode
+
   Delay delay;
+  Meter meter;
+
+#if DSP_LOAD
+  DspLoad dspLoad;
+  std::unique_ptr<DspLoadLogger> dspLoadLogger;  // headless builds only
+#endif
+
+  // Feedback-derived tail of the last applied parameters, capped so that hosts and offline
+  // renders do not keep a near-infinite feedback running for hours
+  static constexpr double maxTailSeconds = 60.0;
+  std::atomic<double> tailSeconds{2.0};
+  double requestedMaxDelayTime = 0.0;  // message thread only
+  Delay::StorageFormat requestedStorageFormat = Delay::StorageFormat::Float32;
+  bool requestedNetworkLayout = false;
+
+  // Parameters read by the audio thread, by position in `rawParameters` and ParameterValues
+  enum ParameterIndex : size_t {
+    delayTimeIndex,
+    feedbackIndex,
+    wetLevelIndex,
+    dryLevelIndex,
+    hiCutFreqIndex,
+    hiCutSlopeIndex,
+    lowCutFreqIndex,
+    modDepthIndex,
+    modRateIndex,
+    modWidthIndex,
+    syncIndex,
+    divisionIndex,
+    modeIndex,
+    timeModeIndex,
+    timeChangeTimeIndex,
+    interpolationIndex,
+    maxDelayIndex,
+    storageIndex,
+    channelLinkIndex,
+    channelSpreadIndex,
+    channelOffsetIndex,  // first of Delay::maxChannels
+    tapCountIndex = channelOffsetIndex + Delay::maxChannels,
+    tapTimeIndex,  // first of Delay::maxTaps, as are the other tap parameters
+    tapDivisionIndex = tapTimeIndex + Delay::maxTaps,
+    tapLevelIndex = tapDivisionIndex + Delay::maxTaps,
+    tapPanIndex = tapLevelIndex + Delay::maxTaps,
+    numParameterValues = tapPanIndex + Delay::maxTaps
+  };
+  using ParameterValues = std::array<float, numParameterValues>;  // unnormalised
+
+  static juce::String getParameterId(size_t index);
+
+  // Raw parameter values, resolved once so processBlock avoids string lookups
+  std::array<std::atomic<float>*, numParameterValues> rawParameters{};
+
+#if CONTROL_SOCKET
+  // Audio thread: overlays the values set over the control socket on `values`. Each is used
+  // until its parameter moves away from where it was when the value arrived, which is when
+  // the message thread moves it to that value, or the host moves it elsewhere, and none
+  // outlasts a recall (a preset or restored state).
+  void applyControlChanges(ParameterValues& values);
+
+  // Socket thread: the status reply
+  juce::var getTelemetry();
+
+  std::unique_ptr<ControlServer> controlServer;
+  ParameterValues controlValues{};
+  ParameterValues controlledFrom{};
+  std::array<bool, numParameterValues> controlled{};
+  Meter::Frame lastMeterFrame;  // socket thread
+#endif
+
+  // A complete set of values for the audio thread to use while the parameters are being
+  // moved to them, published by recallState with an atomic pointer swap
+  struct Recall {
+    ParameterValues values{};
+    uint32_t generation = 0;
+  };
+
+  // Message thread: publishes the values of `state` (a parameter tree), then moves the
+  // parameters to them
+  void recallState(const juce::ValueTree& state);
+  ParameterValues getParameterValues(const juce::ValueTree& state) const;
+
+  // Audio thread: swaps in the last published Recall, handing the previous one back; true if
+  // it did
+  bool adoptPendingRecall();
+  void releaseRetiredRecall();
+
+  std::atomic<Recall*> pendingRecall{nullptr};  // published, not yet swapped in
+  std::array<std::atomic<Recall*>, 2> retiredRecalls{};  // swapped out, waiting to be freed
+  Recall* activeRecall = nullptr;                         // audio thread
+  std::atomic<uint32_t> settledGeneration{0};  // last recall the parameters have caught up with
+  uint32_t recallGeneration = 0;               // message thread only
+
+  // In-memory preset bank, saved with the state (message thread only)
+  struct Preset {
+    juce::String name;
+    juce::ValueTree state;  // a copy of the parameter tree
+  };
+  std::vector<Preset> presets;
+  int currentPreset = 0;
 
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioPluginAudioProcessor)
 };
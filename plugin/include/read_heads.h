@@ -0,0 +1,62 @@
+#pragma once
+
+/**
+ * Base delay (in samples) of the delay line's read head(s).
+ *
+ * A new delay time is reached either by crossfading from the old read head to a second
+ * one at the new position (Crossfade), or by slewing the single head towards it, which
+ * bends the pitch like a tape machine (Glide). A second head only exists while a
+ * crossfade is running; a change arriving mid-fade is queued and starts when it ends.
+ */
+class ReadHeads {
+public:
+  enum class Mode { Crossfade, Glide };
+
+  void prepare(double newSampleRate);
+  void setMode(Mode newMode) { mode = newMode; }
+  void setTransitionTime(float seconds);
+
+  void setTarget(float delaySamples);
+  void snapTo(float delaySamples);
+
+  bool isCrossfading() const { return fadeSamplesLeft > 0; }
+  int getCrossfadeSamplesLeft() const { return fadeSamplesLeft; }
+
+  float getDelay() const { return delay; }
+  float getPreviousDelay() const { return previousDelay; }  // fading-out head
+  float getFade() const { return fade; }                    // gain of the main head
+
+  void advance() {
+    if (glideSamplesLeft > 0)
+      delay = --glideSamplesLeft > 0 ? delay + glideStep : target;
+
+    if (fadeSamplesLeft > 0) {
+      fade += fadeStep;
+      if (--fadeSamplesLeft == 0)
+        finishCrossfade();
+    }
+  }
+
+private:
+  void startCrossfade(float delaySamples);
+  void finishCrossfade();
+
+  double sampleRate = 44100.0;
+  Mode mode = Mode::Crossfade;
+  float transitionSeconds = 0.1f;
+  int transitionSamples = 0;
+
+  float target = 0.0f;
+  float delay = 0.0f;
+  float previousDelay = 0.0f;
+
+  float glideStep = 0.0f;
+  int glideSamplesLeft = 0;
+
+  float fade = 1.0f;
+  float fadeStep = 0.0f;
+  int fadeSamplesLeft = 0;
+
+  float pendingDelay = 0.0f;
+  bool hasPending = false;
+};
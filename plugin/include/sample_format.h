@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstdint>
+#include "simd.h"
+
+/**
+ * Storage formats for the delay line.
+ *
+ * Float32 stores samples as they are. The 16-bit formats halve the memory (and the cache
+ * and bandwidth the kernels use) at the cost of precision: Float16 keeps a relative error
+ * of about 2^-11 (-66 dB below the signal) over a wide range, Int16 a fixed -96 dB floor
+ * below its full scale, decorrelated from the signal with TPDF dither. Both convert four
+ * lanes at a time on load and store. Float64 doubles Float32's memory for hosts processing
+ * in double precision; see Real.
+ *
+ * Real is the type the scalar kernels compute the feedback loop in (toReal and fromReal
+ * convert to and from it): float, except for Float64, whose repeats stay in double
+ * precision from the read through the filter to the write. The vector kernels always
+ * compute in float.
+ */
+namespace sample_format {
+enum class Type { Float32, Float16, Int16, Float64 };
+
+// TPDF noise of +-1 LSB peak for the Int16 format
+class Dither {
+public:
+  float next() { return uniform() - uniform(); }
+  simd::Float4 next4() { return {next(), next(), next(), next()}; }
+
+private:
+  // xorshift32, as uniform noise in [0, 1)
+  float uniform() {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return static_cast<float>(state >> 8) * (1.0f / 16777216.0f);
+  }
+
+  uint32_t state = 0x9e3779b9u;
+};
+
+struct Float32 {
+  using Sample = float;
+  using Real = float;
+
+  static float toFloat(Sample s) { return s; }
+  static Sample fromFloat(float x, Dither&) { return x; }
+  static Real toReal(Sample s) { return s; }
+  static Sample fromReal(Real x, Dither&) { return x; }
+
+  static simd::Float4 load(const Sample* p) { return simd::Float4::load(p); }
+  static void store(Sample* p, simd::Float4 x, Dither&) { x.store(p); }
+};
+
+// IEEE half precision, stored 2^10 times louder: halves stay normal down to -144 dBFS
+// (denormals are flushed in the audio callback) and clip at about +36 dBFS
+struct Float16 {
+  using Sample = uint16_t;
+  using Real = float;
+
+  static constexpr float scale = 1024.0f;
+  static constexpr float limit = 63.9f;
+
+  static float toFloat(Sample s) { return simd::halfToFloat(s) * (1.0f / scale); }
+  static Sample fromFloat(float x, Dither&) {
+    return simd::floatToHalf(std::clamp(x, -limit, limit) * scale);
+  }
+  static Real toReal(Sample s) { return toFloat(s); }
+  static Sample fromReal(Real x, Dither& dither) { return fromFloat(x, dither); }
+
+  static simd::Float4 load(const Sample* p) {
+    return simd::Float4::loadHalf(p) * simd::Float4{1.0f / scale};
+  }
+  static void store(Sample* p, simd::Float4 x, Dither&) {
+    x = simd::Float4::min(simd::Float4::max(x, simd::Float4{-limit}), simd::Float4{limit});
+    (x * simd::Float4{scale}).storeHalf(p);
+  }
+};
+
+// 16-bit integer with full scale at +-4 (12 dB of headroom for the feedback path)
+struct Int16 {
+  using Sample = int16_t;
+  using Real = float;
+
+  static constexpr float fullScale = 4.0f;
+  static constexpr float toSample = 32768.0f / fullScale;
+
+  static float toFloat(Sample s) { return static_cast<float>(s) * (1.0f / toSample); }
+  static Sample fromFloat(float x, Dither& dither) {
+    float q = std::nearbyint(x * toSample + dither.next());
+    return static_cast<Sample>(std::clamp(q, -32768.0f, 32767.0f));
+  }
+  static Real toReal(Sample s) { return toFloat(s); }
+  static Sample fromReal(Real x, Dither& dither) { return fromFloat(x, dither); }
+
+  static simd::Float4 load(const Sample* p) {
+    return simd::Float4::loadInt16(p) * simd::Float4{1.0f / toSample};
+  }
+  static void store(Sample* p, simd::Float4 x, Dither& dither) {
+    (x * simd::Float4{toSample} + dither.next4()).storeInt16(p);
+  }
+};
+
+// Doubles; the vector kernels narrow them to floats on load and widen them on store
+struct Float64 {
+  using Sample = double;
+  using Real = double;
+
+  static float toFloat(Sample s) { return static_cast<float>(s); }
+  static Sample fromFloat(float x, Dither&) { return x; }
+  static Real toReal(Sample s) { return s; }
+  static Sample fromReal(Real x, Dither&) { return x; }
+
+  static simd::Float4 load(const Sample* p) {
+    return {static_cast<float>(p[0]), static_cast<float>(p[1]), static_cast<float>(p[2]),
+            static_cast<float>(p[3])};
+  }
+  static void store(Sample* p, simd::Float4 x, Dither&) {
+    float lanes[4];
+    x.store(lanes);
+    for (int l = 0; l < 4; ++l)
+      p[l] = lanes[l];
+  }
+};
+
+// Calls `fn` with a default-constructed format object matching `type`
+template <typename Fn>
+void dispatch(Type type, Fn&& fn) {
+  switch (type) {
+    case Type::Float16:
+      fn(Float16{});
+      break;
+    case Type::Int16:
+      fn(Int16{});
+      break;
+    case Type::Float64:
+      fn(Float64{});
+      break;
+    case Type::Float32:
+    default:
+      fn(Float32{});
+      break;
+  }
+}
+}  // namespace sample_format
@@ -0,0 +1,266 @@
+#pragma once
+
+// Minimal 4-lane float vector used by the delay kernels.
+//
+// Maps to SSE2 on x86/x64 and NEON on arm64 (ElkOS Cortex-A72). Unlike
+// juce::dsp::SIMDRegister it supports unaligned loads/stores, which the delay
+// line needs because interleaved frames are read at arbitrary positions.
+// Building with DELAY_SIMD=0 (or on an unsupported target) selects a plain
+// scalar implementation with identical semantics.
+//
+// Besides float, lanes load from and store to IEEE half precision and int16 for the
+// compact delay line formats (see sample_format.h).
+
+#ifndef DELAY_SIMD
+#define DELAY_SIMD 1
+#endif
+
+#if DELAY_SIMD && (defined(__SSE2__) || defined(_M_X64) || defined(__x86_64__))
+#define DELAY_SIMD_SSE 1
+#include <emmintrin.h>
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+#elif DELAY_SIMD && (defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__aarch64__))
+#define DELAY_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+namespace simd {
+// Half precision conversions, bit-exact with the vector versions apart from NaN payloads
+// (round to nearest even, subnormals kept, overflow to infinity)
+inline float halfToFloat(uint16_t h) {
+  const uint32_t expMant = (h & 0x7fffu) << 13;
+  float magnitude =
+      std::bit_cast<float>(expMant) * std::bit_cast<float>(uint32_t{(254 - 15) << 23});
+  if ((h & 0x7fffu) > 0x7bffu)  // inf or NaN
+    magnitude = std::bit_cast<float>(std::bit_cast<uint32_t>(magnitude) | (255u << 23));
+  return std::bit_cast<float>(std::bit_cast<uint32_t>(magnitude) | ((h & 0x8000u) << 16));
+}
+
+inline uint16_t floatToHalf(float f) {
+  const uint32_t bits = std::bit_cast<uint32_t>(f);
+  const uint32_t sign = (bits >> 16) & 0x8000u;
+  const uint32_t absBits = bits & 0x7fffffffu;
+
+  uint32_t h;
+  if (absBits >= ((127u + 16) << 23)) {
+    h = absBits > 0x7f800000u ? 0x7e00u : 0x7c00u;  // NaN or overflow to infinity
+  } else if (absBits < ((127u - 14) << 23)) {
+    // Subnormal half: let the float adder align and round the mantissa
+    const uint32_t magic = ((127u - 15) + (23 - 10) + 1) << 23;
+    h = std::bit_cast<uint32_t>(std::bit_cast<float>(absBits) + std::bit_cast<float>(magic)) -
+        magic;
+  } else {
+    const uint32_t mantOdd = (absBits >> 13) & 1u;
+    h = (absBits + (0xfffu - ((127u - 15) << 23)) + mantOdd) >> 13;
+  }
+  return static_cast<uint16_t>(h | sign);
+}
+
+struct Float4 {
+#if DELAY_SIMD_SSE
+  __m128 v;
+
+  Float4() : v(_mm_setzero_ps()) {}
+  explicit Float4(__m128 native) : v(native) {}
+  explicit Float4(float x) : v(_mm_set1_ps(x)) {}
+  Float4(float a, float b, float c, float d) : v(_mm_setr_ps(a, b, c, d)) {}
+
+  static Float4 load(const float* p) { return Float4(_mm_loadu_ps(p)); }
+  void store(float* p) const { _mm_storeu_ps(p, v); }
+
+  friend Float4 operator+(Float4 a, Float4 b) { return Float4(_mm_add_ps(a.v, b.v)); }
+  friend Float4 operator-(Float4 a, Float4 b) { return Float4(_mm_sub_ps(a.v, b.v)); }
+  friend Float4 operator*(Float4 a, Float4 b) { return Float4(_mm_mul_ps(a.v, b.v)); }
+
+  // [a0 a1 b0 b1]
+  static Float4 combineLow(Float4 a, Float4 b) { return Float4(_mm_movelh_ps(a.v, b.v)); }
+  // [a2 a3 b2 b3]
+  static Float4 combineHigh(Float4 a, Float4 b) { return Float4(_mm_movehl_ps(b.v, a.v)); }
+  // [a1 a0 a3 a2]
+  static Float4 swapPairs(Float4 a) {
+    return Float4(_mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(2, 3, 0, 1)));
+  }
+
+  static Float4 min(Float4 a, Float4 b) { return Float4(_mm_min_ps(a.v, b.v)); }
+  static Float4 max(Float4 a, Float4 b) { return Float4(_mm_max_ps(a.v, b.v)); }
+
+#if defined(__F16C__)
+  static Float4 loadHalf(const uint16_t* p) {
+    return Float4(_mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))));
+  }
+  void storeHalf(uint16_t* p) const {
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+  }
+#else
+  // SSE2 has no half conversions; these follow the scalar bit manipulation lane-wise
+  static Float4 loadHalf(const uint16_t* p) {
+    __m128i h = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)),
+                                   _mm_setzero_si128());
+    __m128i expMant = _mm_and_si128(h, _mm_set1_epi32(0x7fff));
+    __m128 magnitude = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(expMant, 13)),
+                                  _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23)));
+    __m128i infNan = _mm_and_si128(_mm_cmpgt_epi32(expMant, _mm_set1_epi32(0x7bff)),
+                                   _mm_set1_epi32(255 << 23));
+    __m128i sign = _mm_slli_epi32(_mm_xor_si128(h, expMant), 16);
+    return Float4(_mm_or_ps(magnitude, _mm_castsi128_ps(_mm_or_si128(sign, infNan))));
+  }
+
+  void storeHalf(uint16_t* p) const {
+    const __m128i magic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+    __m128 signMask = _mm_and_ps(v, _mm_set1_ps(-0.0f));
+    __m128 absF = _mm_xor_ps(v, signMask);
+    __m128i absBits = _mm_castps_si128(absF);
+
+    __m128i isNan = _mm_castps_si128(_mm_cmpunord_ps(absF, absF));
+    __m128i isRegular = _mm_cmpgt_epi32(_mm_set1_epi32((127 + 16) << 23), absBits);
+    __m128i isSubnormal = _mm_cmpgt_epi32(_mm_set1_epi32((127 - 14) << 23), absBits);
+    __m128i infOrNan = _mm_or_si128(_mm_and_si128(isNan, _mm_set1_epi32(0x200)),
+                                    _mm_set1_epi32(0x7c00));
+
+    __m128i subnormal =
+        _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absF, _mm_castsi128_ps(magic))), magic);
+
+    __m128i mantOdd = _mm_srai_epi32(_mm_slli_epi32(absBits, 31 - 13), 31);
+    __m128i normal = _mm_srli_epi32(
+        _mm_sub_epi32(_mm_add_epi32(absBits, _mm_set1_epi32(0xfff - ((127 - 15) << 23))),
+                      mantOdd),
+        13);
+
+    __m128i finite = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal),
+                                  _mm_andnot_si128(isSubnormal, normal));
+    __m128i h = _mm_or_si128(_mm_and_si128(isRegular, finite),
+                             _mm_andnot_si128(isRegular, infOrNan));
+    h = _mm_or_si128(h, _mm_srai_epi32(_mm_castps_si128(signMask), 16));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_packs_epi32(h, h));
+  }
+#endif
+
+  static Float4 loadInt16(const int16_t* p) {
+    __m128i x = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+    return Float4(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16)));
+  }
+
+  // Rounds to nearest and saturates
+  void storeInt16(int16_t* p) const {
+    __m128i x = _mm_cvtps_epi32(v);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_packs_epi32(x, x));
+  }
+#elif DELAY_SIMD_NEON
+  float32x4_t v;
+
+  Float4() : v(vdupq_n_f32(0.0f)) {}
+  explicit Float4(float32x4_t native) : v(native) {}
+  explicit Float4(float x) : v(vdupq_n_f32(x)) {}
+  Float4(float a, float b, float c, float d) {
+    const float lanes[4] = {a, b, c, d};
+    v = vld1q_f32(lanes);
+  }
+
+  static Float4 load(const float* p) { return Float4(vld1q_f32(p)); }
+  void store(float* p) const { vst1q_f32(p, v); }
+
+  friend Float4 operator+(Float4 a, Float4 b) { return Float4(vaddq_f32(a.v, b.v)); }
+  friend Float4 operator-(Float4 a, Float4 b) { return Float4(vsubq_f32(a.v, b.v)); }
+  friend Float4 operator*(Float4 a, Float4 b) { return Float4(vmulq_f32(a.v, b.v)); }
+
+  static Float4 combineLow(Float4 a, Float4 b) {
+    return Float4(vcombine_f32(vget_low_f32(a.v), vget_low_f32(b.v)));
+  }
+  static Float4 combineHigh(Float4 a, Float4 b) {
+    return Float4(vcombine_f32(vget_high_f32(a.v), vget_high_f32(b.v)));
+  }
+  static Float4 swapPairs(Float4 a) { return Float4(vrev64q_f32(a.v)); }
+
+  static Float4 min(Float4 a, Float4 b) { return Float4(vminq_f32(a.v, b.v)); }
+  static Float4 max(Float4 a, Float4 b) { return Float4(vmaxq_f32(a.v, b.v)); }
+
+#if defined(__aarch64__)
+  static Float4 loadHalf(const uint16_t* p) {
+    return Float4(vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(p))));
+  }
+  void storeHalf(uint16_t* p) const { vst1_u16(p, vreinterpret_u16_f16(vcvt_f16_f32(v))); }
+
+  void storeInt16(int16_t* p) const { vst1_s16(p, vqmovn_s32(vcvtnq_s32_f32(v))); }
+#else
+  static Float4 loadHalf(const uint16_t* p) {
+    return {halfToFloat(p[0]), halfToFloat(p[1]), halfToFloat(p[2]), halfToFloat(p[3])};
+  }
+  void storeHalf(uint16_t* p) const {
+    float x[4];
+    store(x);
+    for (int i = 0; i < 4; ++i)
+      p[i] = floatToHalf(x[i]);
+  }
+
+  void storeInt16(int16_t* p) const {
+    // vcvtq rounds towards zero, so round half away from zero first
+    float32x4_t half = vbslq_f32(vdupq_n_u32(0x80000000u), v, vdupq_n_f32(0.5f));
+    vst1_s16(p, vqmovn_s32(vcvtq_s32_f32(vaddq_f32(v, half))));
+  }
+#endif
+
+  static Float4 loadInt16(const int16_t* p) {
+    return Float4(vcvtq_f32_s32(vmovl_s16(vld1_s16(p))));
+  }
+#else
+  float v[4];
+
+  Float4() : v{0.0f, 0.0f, 0.0f, 0.0f} {}
+  explicit Float4(float x) : v{x, x, x, x} {}
+  Float4(float a, float b, float c, float d) : v{a, b, c, d} {}
+
+  static Float4 load(const float* p) { return {p[0], p[1], p[2], p[3]}; }
+  void store(float* p) const {
+    for (int i = 0; i < 4; ++i)
+      p[i] = v[i];
+  }
+
+  friend Float4 operator+(Float4 a, Float4 b) {
+    return {a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]};
+  }
+  friend Float4 operator-(Float4 a, Float4 b) {
+    return {a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]};
+  }
+  friend Float4 operator*(Float4 a, Float4 b) {
+    return {a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]};
+  }
+
+  static Float4 combineLow(Float4 a, Float4 b) { return {a.v[0], a.v[1], b.v[0], b.v[1]}; }
+  static Float4 combineHigh(Float4 a, Float4 b) { return {a.v[2], a.v[3], b.v[2], b.v[3]}; }
+  static Float4 swapPairs(Float4 a) { return {a.v[1], a.v[0], a.v[3], a.v[2]}; }
+
+  static Float4 min(Float4 a, Float4 b) {
+    return {std::min(a.v[0], b.v[0]), std::min(a.v[1], b.v[1]), std::min(a.v[2], b.v[2]),
+            std::min(a.v[3], b.v[3])};
+  }
+  static Float4 max(Float4 a, Float4 b) {
+    return {std::max(a.v[0], b.v[0]), std::max(a.v[1], b.v[1]), std::max(a.v[2], b.v[2]),
+            std::max(a.v[3], b.v[3])};
+  }
+
+  static Float4 loadHalf(const uint16_t* p) {
+    return {halfToFloat(p[0]), halfToFloat(p[1]), halfToFloat(p[2]), halfToFloat(p[3])};
+  }
+  void storeHalf(uint16_t* p) const {
+    for (int i = 0; i < 4; ++i)
+      p[i] = floatToHalf(v[i]);
+  }
+
+  static Float4 loadInt16(const int16_t* p) {
+    return {static_cast<float>(p[0]), static_cast<float>(p[1]), static_cast<float>(p[2]),
+            static_cast<float>(p[3])};
+  }
+  void storeInt16(int16_t* p) const {
+    for (int i = 0; i < 4; ++i)
+      p[i] = static_cast<int16_t>(std::clamp(std::nearbyint(v[i]), -32768.0f, 32767.0f));
+  }
+#endif
+};
+}  // namespace simd
@@ -0,0 +1,228 @@
+#include "control_server.h"
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0  // macOS, where accepted sockets set SO_NOSIGPIPE instead
+#endif
+
+namespace {
+// How often the thread wakes up to check whether it should stop
+constexpr int pollIntervalMs = 100;
+
+// Longest request accepted; a client sending more without a newline is dropped
+constexpr size_t maxRequestLength = 4096;
+
+bool parseFloat(const juce::String& text, float& value) {
+  const auto utf8 = text.toStdString();
+  char* end = nullptr;
+  value = std::strtof(utf8.c_str(), &end);
+  return end != utf8.c_str() && *end == '\0' && std::isfinite(value);
+}
+
+void logError(const juce::String& what) {
+  juce::Logger::writeToLog("[Control] " + what + ": " + juce::String(std::strerror(errno)));
+}
+}  // namespace
+
+ControlServer::ControlServer(const juce::String& socketPath,
+                             std::vector<Parameter> parametersToControl,
+                             Telemetry telemetryToReport)
+    : juce::Thread("Control server"),
+      path(socketPath),
+      parameters(std::move(parametersToControl)),
+      telemetry(std::move(telemetryToReport)),
+      parameterValues(new std::atomic<float>[parameters.size()]),
+      parameterChanged(new std::atomic<bool>[parameters.size()]) {
+  for (size_t i = 0; i < parameters.size(); ++i) {
+    parameterValues[i].store(0.0f);
+    parameterChanged[i].store(false);
+  }
+
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (path.getNumBytesAsUTF8() >= sizeof(address.sun_path)) {
+    juce::Logger::writeToLog("[Control] Socket path too long: " + path);
+    return;
+  }
+  std::strncpy(address.sun_path, path.toRawUTF8(), sizeof(address.sun_path) - 1);
+  const auto* generic = reinterpret_cast<const sockaddr*>(&address);
+
+  listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0) {
+    logError("socket");
+    return;
+  }
+
+  // A socket file nobody answers on was left by a process that did not shut down cleanly
+  bool bound = bind(listener, generic, sizeof(address)) == 0;
+  if (!bound && errno == EADDRINUSE) {
+    const int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    const bool answered = probe >= 0 && connect(probe, generic, sizeof(address)) == 0;
+    if (probe >= 0)
+      close(probe);
+    if (!answered) {
+      unlink(path.toRawUTF8());
+      bound = bind(listener, generic, sizeof(address)) == 0;
+    } else {
+      errno = EADDRINUSE;
+    }
+  }
+
+  if (!bound || listen(listener, maxClients) != 0) {
+    logError("Cannot listen on " + path);
+    close(listener);
+    listener = -1;
+    return;
+  }
+
+  juce::Logger::writeToLog("[Control] Listening on " + path);
+  startThread(juce::Thread::Priority::low);
+}
+
+ControlServer::~ControlServer() {
+  stopThread(1000);
+  for (auto& client : clients)
+    close(client.socket);
+  if (listener >= 0) {
+    close(listener);
+    unlink(path.toRawUTF8());
+  }
+}
+
+void ControlServer::run() {
+  std::vector<pollfd> sockets;
+
+  while (!threadShouldExit()) {
+    sockets.clear();
+    sockets.push_back({listener, POLLIN, 0});
+    for (const auto& client : clients)
+      sockets.push_back({client.socket, POLLIN, 0});
+
+    if (poll(sockets.data(), sockets.size(), pollIntervalMs) <= 0)
+      continue;
+
+    // Clients first, as accepting one changes `clients`
+    for (size_t c = clients.size(); c-- > 0;) {
+      if (sockets[c + 1].revents == 0 || serve(clients[c]))
+        continue;
+      close(clients[c].socket);
+      clients.erase(clients.begin() + static_cast<std::ptrdiff_t>(c));
+    }
+
+    if ((sockets[0].revents & POLLIN) != 0) {
+      const int socket = accept(listener, nullptr, nullptr);
+      if (socket < 0) {
+        logError("accept");
+      } else if (clients.size() >= static_cast<size_t>(maxClients)) {
+        close(socket);
+      } else {
+#ifdef SO_NOSIGPIPE
+        const int on = 1;
+        setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        clients.push_back({socket, {}});
+      }
+    }
+  }
+}
+
+bool ControlServer::serve(Client& client) {
+  char received[1024];
+  const auto numReceived = recv(client.socket, received, sizeof(received), 0);
+  if (numReceived <= 0)
+    return false;
+  client.pending.append(received, static_cast<size_t>(numReceived));
+
+  for (size_t end; (end = client.pending.find('\n')) != std::string::npos;) {
+    const auto request = juce::String::fromUTF8(client.pending.data(), static_cast<int>(end));
+    client.pending.erase(0, end + 1);
+
+    const auto reply = (handle(request.trim()) + "\n").toStdString();
+    for (size_t sent = 0; sent < reply.size();) {
+      const auto n = send(client.socket, reply.data() + sent, reply.size() - sent, MSG_NOSIGNAL);
+      if (n <= 0)
+        return false;
+      sent += static_cast<size_t>(n);
+    }
+  }
+
+  return client.pending.size() <= maxRequestLength;
+}
+
+juce::String ControlServer::handle(const juce::String& request) {
+  const auto tokens = juce::StringArray::fromTokens(request, " \t", "");
+  if (tokens.isEmpty())
+    return "error empty request";
+
+  if (tokens[0] == "set")
+    return handleSet(tokens);
+  if (tokens[0] == "preset")
+    return handlePreset(tokens);
+  if (tokens[0] == "status" && tokens.size() == 1)
+    return juce::JSON::toString(telemetry != nullptr ? telemetry() : juce::var(), true);
+
+  return "error unknown request " + tokens[0].quoted();
+}
+
+juce::String ControlServer::handleSet(const juce::StringArray& tokens) {
+  const int numChanges = (tokens.size() - 1) / 2;
+  if (numChanges == 0 || tokens.size() % 2 == 0)
+    return "error expected set <id> <value> ...";
+  if (numChanges > maxChangesPerBlock)
+    return "error more than " + juce::String(maxChangesPerBlock) + " changes";
+
+  std::array<Change, maxChangesPerBlock> batch;
+  for (int k = 0; k < numChanges; ++k) {
+    const auto& id = tokens[1 + k * 2];
+    auto parameter = std::find_if(parameters.begin(), parameters.end(),
+                                  [&](const Parameter& p) { return p.id == id; });
+    if (parameter == parameters.end())
+      return "error unknown parameter " + id.quoted();
+
+    float value;
+    if (!parseFloat(tokens[2 + k * 2], value))
+      return "error bad value for " + id;
+
+    auto& change = batch[static_cast<size_t>(k)];
+    change.index = static_cast<uint32_t>(parameter - parameters.begin());
+    change.value = parameter->range.snapToLegalValue(value);
+  }
+  batch[0].batchSize = static_cast<uint32_t>(numChanges);
+
+  if (fifo.getFreeSpace() < numChanges)
+    return "error busy";
+
+  int k = 0;
+  fifo.write(numChanges).forEach(
+      [&](int index) { queue[static_cast<size_t>(index)] = batch[static_cast<size_t>(k++)]; });
+
+  for (int c = 0; c < numChanges; ++c) {
+    const auto& change = batch[static_cast<size_t>(c)];
+    parameterValues[change.index].store(change.value, std::memory_order_relaxed);
+    parameterChanged[change.index].store(true, std::memory_order_release);
+  }
+  return "ok";
+}
+
+juce::String ControlServer::handlePreset(const juce::StringArray& tokens) {
+  float index;
+  if (tokens.size() != 2 || !parseFloat(tokens[1], index) || index < 0.0f ||
+      index != std::floor(index))
+    return "error expected preset <index>";
+  if (index >= static_cast<float>(numPresets.load()))
+    return "error no preset " + tokens[1] + " of " + juce::String(numPresets.load());
+
+  // The recall replaces any values set before it that the parameters have not taken yet
+  for (size_t i = 0; i < parameters.size(); ++i)
+    parameterChanged[i].store(false, std::memory_order_relaxed);
+  requestedPreset.store(static_cast<int>(index));
+  return "ok";
+}
@@ -1,29 +1,195 @@
 #include "delay.h"
+#include "simd.h"
 #include <cmath>
 #include <algorithm>  // for std::clamp
 
-Delay::Delay() : sampleRate(44100.0), maxDelayTime(2.0), modPhase(0.0f), writeIndex(0) {
+namespace {
+// Lane l from tap[l][offset], converted the way Format converts a contiguous load. Floats go
+// straight into the register: staging them in memory for a vector load would stall on
+// store forwarding at every tap.
+template <typename Format>
+simd::Float4 gather(const typename Format::Sample* const* tap, size_t offset) {
+  if constexpr (std::is_same_v<Format, sample_format::Float32>) {
+    return {tap[0][offset], tap[1][offset], tap[2][offset], tap[3][offset]};
+  } else {
+    const typename Format::Sample samples[4] = {tap[0][offset], tap[1][offset], tap[2][offset],
+                                                tap[3][offset]};
+    return Format::load(samples);
+  }
+}
+
+// Delay time of each network line as a fraction of the delay time. Lines 0 and 1 carry the
+// L/R repeats when the diffusion is off; the others are shorter, far enough from simple
+// ratios that their echoes do not line up.
+constexpr std::array<float, 4> networkRatios = {1.0f, 1.0f, 0.837f, 0.709f};
+}  // namespace
+
+Delay::Delay() : sampleRate(44100.0), delayLine(makeDelayLine(storageFormat)) {
   setSampleRate(sampleRate);
 }
 
+Delay::~Delay() {
+  delete pendingLine.exchange(nullptr);
+  delete incomingLine;
+  releaseRetiredDelayLine();
+}
+
 void Delay::setSampleRate(double newSampleRate) {
   sampleRate = newSampleRate;
-  size_t bufferSize = static_cast<size_t>(sampleRate * maxDelayTime) + 1;
 
-  for (auto& buf : delayBuffer)
-    buf.assign(bufferSize, 0.0f);
+  // Not processing now, so a line still waiting to be swapped in can go
+  delete pendingLine.exchange(nullptr);
+  delete incomingLine;
+  incomingLine = nullptr;
+  releaseRetiredDelayLine();
+
+  if (delayLine->getFormat() != storageFormat)
+    delayLine = makeDelayLine(storageFormat);
+  delayLine->prepare(static_cast<size_t>(sampleRate * maxDelayTime) + 1,
+                     getLineLanes(networkLayout));
+  delayLine->ensureClean(readReach);
+  lfo.setSampleRate(sampleRate);
+  readHeads.prepare(sampleRate);
+
+  for (auto* smoothed : {&feedback, &wetLevel, &dryLevel, &modDepth})
+    smoothed->reset(sampleRate, smoothingTimeSeconds);
+  for (auto& offset : channelOffsets)
+    offset.reset(sampleRate, smoothingTimeSeconds);
+  for (auto& offset : networkOffsets)
+    offset.reset(sampleRate, smoothingTimeSeconds);
+  pingPongMix.reset(sampleRate, modeChangeSeconds);
+  diffusion.reset(sampleRate, modeChangeSeconds);
+  for (size_t t = 0; t < maxTaps; ++t) {
+    tapDelays[t].reset(sampleRate, tapGlideSeconds);
+    for (auto& gains : tapGains)
+      gains[t].reset(sampleRate, smoothingTimeSeconds);
+  }
+  snapToTargets = true;
+
+  // Nothing from before (re)preparing may leak into the output
+  filter.prepare(sampleRate, smoothingTimeSeconds);
+  std::fill(&allpassState[0][0], &allpassState[0][0] + 2 * maxChannels, 0.0f);
+  std::fill(&preciseAllpassState[0][0], &preciseAllpassState[0][0] + 4, 0.0);
+  std::fill(&tapAllpassState[0][0], &tapAllpassState[0][0] + 2 * maxTaps, 0.0f);
 
   fadeInIncrement = 1.0f / static_cast<float>(sampleRate * 0.02);  // 20ms fade-in
   fadeInAmount = 0.0f;
+
+  inputPeak = 0.0f;
+  silentSamples = 0;
+  idle = false;
+}
+
+void Delay::setNumChannels(int newNumChannels) {
+  jassert(newNumChannels >= 1 && newNumChannels <= maxChannels);
+  numChannels = std::clamp(newNumChannels, 1, maxChannels);
+
+  // The stereo kernels read L/R frames, wider layouts whole registers
+  numLanes = numChannels <= 2 ? 2 : static_cast<size_t>((numChannels + 3) & ~3);
+}
+
+void Delay::setMaxDelayTime(double seconds) {
+  maxDelayTime = std::clamp(seconds, 0.1, maxDelayLimit);
+}
+
+std::unique_ptr<DelayLine> Delay::createDelayLine(double maxDelaySeconds,
+                                                  StorageFormat format,
+                                                  bool network) const {
+  maxDelaySeconds = std::clamp(maxDelaySeconds, 0.1, maxDelayLimit);
+  auto line = makeDelayLine(format);
+  line->prepare(static_cast<size_t>(sampleRate * maxDelaySeconds) + 1, getLineLanes(network));
+  return line;
+}
+
+void Delay::submitDelayLine(std::unique_ptr<DelayLine> line) {
+  releaseRetiredDelayLine();
+  delete pendingLine.exchange(line.release());
+}
+
+void Delay::releaseRetiredDelayLine() {
+  delete retiredLine.exchange(nullptr);
+}
+
+void Delay::adoptPendingDelayLine(int numSamples) {
+  // The old line is only handed back once the previous one has been released, so the
+  // audio thread never has to free anything
+  if (retiredLine.load(std::memory_order_acquire) != nullptr)
+    return;
+
+  if (pendingLine.load(std::memory_order_relaxed) != nullptr) {
+    DelayLine* next = pendingLine.exchange(nullptr, std::memory_order_acq_rel);
+    if (next != nullptr && incomingLine != nullptr) {
+      // Submitted again while the last one waited; that one goes back unused
+      retiredLine.store(incomingLine, std::memory_order_release);
+      incomingLine = next;
+      incomingLine->beginHistoryFrom(*delayLine, readReach);
+      return;
+    }
+    if (next != nullptr) {
+      incomingLine = next;
+      incomingLine->beginHistoryFrom(*delayLine, readReach);
+    }
+  }
+
+  if (incomingLine == nullptr)
+    return;
+
+  // The echoes still within reach are carried over a part per block while the old line runs
+  // on; twice a block's worth at the least, so it always catches up
+  if (!incomingLine->copyHistory(2 * static_cast<size_t>(numSamples)))
+    return;
+
+  // A line of the other layout switches between the network and the stereo kernels, which
+  // only share the plain L/R lanes: it waits until the running kernel has ramped its
+  // cross-feed out
+  const bool wasNetwork = isNetworkLine();
+  if (incomingLine->getNumChannels() != delayLine->getNumChannels()) {
+    const auto& routing = wasNetwork ? diffusion : pingPongMix;
+    if (routing.isSmoothing() || routing.getCurrentValue() != 0.0f)
+      return;
+  }
+
+  const bool wasDouble = delayLine->getFormat() == StorageFormat::Float64;
+  retiredLine.store(delayLine.release(), std::memory_order_release);
+  delayLine.reset(incomingLine);
+  incomingLine = nullptr;
+
+  // The scalar kernels carry on from the filter and allpass states of the other precision
+  const bool isDouble = delayLine->getFormat() == StorageFormat::Float64;
+  if (isDouble != wasDouble) {
+    filter.copyState(isDouble);
+    for (size_t head = 0; head < 2; ++head) {
+      for (size_t c = 0; c < 2; ++c) {
+        if (isDouble)
+          preciseAllpassState[head][c] = allpassState[head][c];
+        else
+          allpassState[head][c] = static_cast<float>(preciseAllpassState[head][c]);
+      }
+    }
+  }
+
+  // The network starts out as the L/R lanes it was given and ramps up from there
+  if (isNetworkLine() && !wasNetwork) {
+    diffusion.setCurrentAndTargetValue(0.0f);
+    diffusion.setTargetValue(mode == DelayMode::Diffuse ? 1.0f : 0.0f);
+  }
 }
 
 void Delay::setParameters(const Parameters& params) {
-  feedback = std::clamp(params.feedback, 0.0f, 0.99f);
-  wetLevel = params.wetLevel;
-  dryLevel = params.dryLevel;
-  modDepth = params.modulationDepthSeconds;
-  modRate = params.modulationRateHz;
+  feedback.setTargetValue(std::clamp(params.feedback, 0.0f, 0.99f));
+  wetLevel.setTargetValue(params.wetLevel);
+  dryLevel.setTargetValue(params.dryLevel);
+  modDepth.setTargetValue(params.modulationDepthSeconds / 100.0f);
+  lfo.setFrequency(params.modulationRateHz);
+  lfo.setPhaseOffset(params.modulationPhaseOffset);
+  wideModulation = params.modulationPhaseOffset != 0.0f;
   mode = params.mode;
+  pingPongMix.setTargetValue(mode == DelayMode::PingPong ? 1.0f : 0.0f);
+  diffusion.setTargetValue(mode == DelayMode::Diffuse ? 1.0f : 0.0f);
+
+  readHeads.setMode(params.timeChange);
+  readHeads.setTransitionTime(params.timeChangeSeconds);
+  interpolation = params.interpolation;
 
   // Set delay time based on tempo sync or manual time input
   float newDelayTime =
@@ -32,102 +198,1185 @@ void Delay::setParameters(const Parameters& params) {
   if (std::abs(delayTimeSeconds - newDelayTime) > 0.0001f) {
     delayTimeSeconds = newDelayTime;
     samplesUntilNextFlip = static_cast<size_t>(delayTimeSeconds * sampleRate);
+    readHeads.setTarget(static_cast<float>(delayTimeSeconds * sampleRate));
+  }
+
+  for (int c = 0; c < maxChannels; ++c) {
+    float seconds = 0.0f;
+    if (c < numChannels && params.linkChannelOffsets)
+      seconds = numChannels > 1 ? params.channelSpreadSeconds * static_cast<float>(c) /
+                                      static_cast<float>(numChannels - 1)
+                                : 0.0f;
+    else if (c < numChannels)
+      seconds = params.channelOffsetSeconds[static_cast<size_t>(c)];
+    channelOffsets[static_cast<size_t>(c)].setTargetValue(
+        static_cast<float>(std::round(seconds * sampleRate)));
+  }
+
+  // Network lines are whole samples shorter than the delay time, see processNetworkRun
+  const float delayTarget = static_cast<float>(delayTimeSeconds * sampleRate);
+  for (size_t l = 0; l < networkLines; ++l)
+    networkOffsets[l].setTargetValue(std::round(delayTarget * (1.0f - networkRatios[l])));
+
+  // Taps past numTaps fade out where they are; a silent tap jumps to its new time rather
+  // than gliding there. A tap reads up to a run further back than its delay, and no further
+  // than the line in use was made for.
+  const float longestTap = std::max(static_cast<float>(delayLine->getPreparedDelay()) -
+                                        static_cast<float>(tapRunLength),
+                                    0.0f);
+  for (size_t t = 0; t < maxTaps; ++t) {
+    const auto& tap = params.taps[t];
+    const bool enabled = static_cast<int>(t) < params.numTaps;
+    const float pan = std::clamp(tap.pan, -1.0f, 1.0f);
+    const float level = enabled ? tap.level : 0.0f;
+    tapGains[0][t].setTargetValue(level * std::min(1.0f, 1.0f - pan));
+    tapGains[1][t].setTargetValue(level * std::min(1.0f, 1.0f + pan));
+
+    if (enabled) {
+      const float seconds = params.syncToTempo ? (60.0f / params.hostBpm) * tap.noteDivision
+                                               : tap.delayTimeSeconds;
+      const float samples = std::clamp(static_cast<float>(seconds * sampleRate), 0.0f, longestTap);
+      if (tapGains[0][t].getCurrentValue() == 0.0f && tapGains[1][t].getCurrentValue() == 0.0f)
+        tapDelays[t].setCurrentAndTargetValue(samples);
+      else
+        tapDelays[t].setTargetValue(samples);
+    }
+  }
+
+  // Ramped in the kernels; computing the coefficients never allocates
+  filter.setSlope(params.hiCutSlope);
+  filter.setCutoff(params.hiCutFreq);
+  filter.setLowCut(params.lowCutFreq);
+
+  // The first parameters after (re)preparing are applied directly, later ones are ramped
+  if (snapToTargets) {
+    for (auto* smoothed :
+         {&feedback, &wetLevel, &dryLevel, &modDepth, &pingPongMix, &diffusion})
+      smoothed->setCurrentAndTargetValue(smoothed->getTargetValue());
+    for (auto& offset : channelOffsets)
+      offset.setCurrentAndTargetValue(offset.getTargetValue());
+    for (auto& offset : networkOffsets)
+      offset.setCurrentAndTargetValue(offset.getTargetValue());
+    readHeads.snapTo(static_cast<float>(delayTimeSeconds * sampleRate));
+    for (size_t t = 0; t < maxTaps; ++t) {
+      tapDelays[t].setCurrentAndTargetValue(tapDelays[t].getTargetValue());
+      for (auto& gains : tapGains)
+        gains[t].setCurrentAndTargetValue(gains[t].getTargetValue());
+    }
+    filter.snapToCutoff();
+    snapToTargets = false;
+  }
+
+  // Offsets are whole samples once settled, see processMultichannelRun
+  sharedFraction = !wideModulation;
+  uniformLanes = sharedFraction;
+  for (size_t c = 0; c < maxChannels; ++c) {
+    sharedFraction = sharedFraction && !channelOffsets[c].isSmoothing();
+    laneOffsets[c] = static_cast<size_t>(channelOffsets[c].getTargetValue());
+    uniformLanes = uniformLanes && laneOffsets[c] == 0;
+  }
+  uniformLanes = uniformLanes && sharedFraction;
+
+  networkSharedFraction = true;
+  for (size_t l = 0; l < networkLines; ++l) {
+    networkSharedFraction = networkSharedFraction && !networkOffsets[l].isSmoothing();
+    networkShortening[l] = static_cast<size_t>(networkOffsets[l].getTargetValue());
+  }
+
+  // Taps are read by the mono and stereo kernels only
+  numTapGroups = 0;
+  float longestTapDelay = 0.0f;
+  for (size_t t = 0; t < maxTaps && numChannels <= 2; ++t) {
+    bool audible = false;
+    for (const auto& gains : tapGains)
+      audible = audible || gains[t].getCurrentValue() != 0.0f || gains[t].getTargetValue() != 0.0f;
+    if (audible) {
+      numTapGroups = t / 4 + 1;
+      longestTapDelay = std::max(
+          {longestTapDelay, tapDelays[t].getCurrentValue(), tapDelays[t].getTargetValue()});
+    }
+  }
+
+  // Oldest frame any read can reach with these settings, so the echoes a new line has to
+  // carry over and the tail only go that far back
+  float longestDelay = std::max({readHeads.getDelay(), readHeads.getPreviousDelay(),
+                                 static_cast<float>(delayTimeSeconds * sampleRate)});
+  float longestOffset = 0.0f;
+  for (const auto& offset : channelOffsets)
+    longestOffset = std::max({longestOffset, offset.getCurrentValue(), offset.getTargetValue()});
+  float deepestMod = std::max(modDepth.getCurrentValue(), modDepth.getTargetValue()) *
+                     static_cast<float>(sampleRate);
+  // Taps read up to a run further back, see processTapsRun
+  if (numTapGroups > 0)
+    longestDelay = std::max(longestDelay, longestTapDelay + static_cast<float>(tapRunLength));
+  readReach = static_cast<size_t>(longestDelay + longestOffset + deepestMod) +
+              DelayLine::guardFrames + 2;
+
+  tailSeconds = static_cast<double>(getDecaySamples(1.0f)) / sampleRate;
+}
+
+size_t Delay::getDecaySamples(float level) const {
+  // Overlapping repeats add up to at most 1 / (1 - feedback) of the input, and the
+  // interpolators may overshoot a little on top of that
+  const float fb = std::max(feedback.getCurrentValue(), feedback.getTargetValue());
+  const float residual = 2.0f * level / (1.0f - fb);
+
+  // Every pass through the longest reachable delay scales the repeats by the feedback
+  size_t repeats = 0;
+  if (residual > silenceThreshold && fb > 0.0f)
+    repeats =
+        static_cast<size_t>(std::ceil(std::log(silenceThreshold / residual) / std::log(fb)));
+
+  return readReach * (repeats + 1);
+}
+
+template <typename Sample>
+bool Delay::skipIfIdle(Sample* const* channels, int numChannelsToCheck, int numSamples) {
+  float peak = 0.0f;
+  for (int c = 0; c < numChannelsToCheck; ++c) {
+    auto range = juce::FloatVectorOperations::findMinAndMax(channels[c], numSamples);
+    peak = std::max(
+        {peak, static_cast<float>(-range.getStart()), static_cast<float>(range.getEnd())});
+  }
+
+  if (peak > silenceThreshold) {
+    inputPeak = std::max(inputPeak, peak);
+    silentSamples = 0;
+    idle = false;
+    return false;
+  }
+
+  if (!idle) {
+    silentSamples += static_cast<size_t>(numSamples);
+    if (silentSamples < getDecaySamples(inputPeak))
+      return false;
+
+    idle = true;
+    inputPeak = 0.0f;
+  }
+
+  // The input is below silenceThreshold too, so a per-block dry gain is inaudible
+  const auto dry = static_cast<Sample>(dryLevel.skip(numSamples));
+  for (int c = 0; c < numChannelsToCheck; ++c)
+    juce::FloatVectorOperations::multiply(channels[c], dry, numSamples);
+  return true;
+}
+
+void Delay::getRepeatLevels(float* levels, int numRepeats, int windowSamples) const {
+  constexpr int probes = 8;
+  const size_t channelsToRead =
+      std::min(static_cast<size_t>(numChannels), delayLine->getNumChannels());
+  const auto spacing = static_cast<size_t>(std::max(windowSamples / probes, 1));
+
+  // Repeat k is heard now from the line one delay time further back than repeat k - 1
+  float gain = wetLevel.getTargetValue();
+  float frame[DelayLine::maxChannels];
+  for (int k = 0; k < numRepeats; ++k) {
+    const auto tap = static_cast<size_t>(readHeads.getDelay() * static_cast<float>(k + 1));
+
+    float sum = 0.0f;
+    for (size_t p = 0; p < probes; ++p) {
+      delayLine->readFrameAt(tap + p * spacing, frame);
+      for (size_t c = 0; c < channelsToRead; ++c)
+        sum += frame[c] * frame[c];
+    }
+    levels[k] = gain * std::sqrt(sum / static_cast<float>(probes * channelsToRead));
+    gain *= feedback.getTargetValue();
   }
+}
 
-  // Update hi-cut filter frequency if changed
-  if (std::abs(hiCutFreq - params.hiCutFreq) > 1.0f && params.hiCutFreq > 20.0f &&
-      params.hiCutFreq < sampleRate * 0.5f) {
-    hiCutFreq = params.hiCutFreq;
+void Delay::beginRun() {
+  if (readHeads.isCrossfading() && readHeads.getFade() == 0.0f) {
+    for (size_t c = 0; c < maxChannels; ++c) {
+      allpassState[1][c] = allpassState[0][c];
+      allpassState[0][c] = 0.0f;
+    }
+    for (size_t c = 0; c < 2; ++c) {
+      preciseAllpassState[1][c] = preciseAllpassState[0][c];
+      preciseAllpassState[0][c] = 0.0;
+    }
+  }
+}
 
-    hiCutFilterL.coefficients =
-        juce::dsp::IIR::Coefficients<float>::makeLowPass(sampleRate, hiCutFreq);
-    hiCutFilterR.coefficients =
-        juce::dsp::IIR::Coefficients<float>::makeLowPass(sampleRate, hiCutFreq);
+template <bool Topologies, typename Fn>
+void Delay::dispatchPath(bool general, Fn&& fn) {
+  if (general) {
+    fn(GeneralPath{});
+    return;
   }
+
+  const bool pingPong = Topologies && mode == DelayMode::PingPong;
+  const bool modulated = modDepth.isSmoothing() || modDepth.getCurrentValue() != 0.0f;
+  const bool filtered = filter.isActive();
+
+  auto withFlags = [&](auto topology) {
+    constexpr Topology T = decltype(topology)::value;
+    if (modulated) {
+      if (filtered)
+        fn(RunPath<T, true, true>{});
+      else
+        fn(RunPath<T, true, false>{});
+    } else {
+      if (filtered)
+        fn(RunPath<T, false, true>{});
+      else
+        fn(RunPath<T, false, false>{});
+    }
+  };
+
+  if constexpr (Topologies) {
+    if (pingPong) {
+      withFlags(std::integral_constant<Topology, Topology::PingPong>{});
+      return;
+    }
+  }
+  withFlags(std::integral_constant<Topology, Topology::Independent>{});
 }
 
-void Delay::processMono(float* samples, int numSamples) {
-  auto& buf = delayBuffer[0];
+template <typename Sample>
+void Delay::processMono(Sample* samples, int numSamples) {
+  adoptPendingDelayLine(numSamples);
+  delayLine->cleanAhead();
+
+  if (skipIfIdle(&samples, 1, numSamples))
+    return;
+
+  dispatch([&](auto policy, auto format) {
+    using Interp = decltype(policy);
+    using Format = decltype(format);
+
+    for (int i = 0; i < numSamples;) {
+      int run = getRunLength(numSamples - i);
+      beginRun();
+
+      if (isNetworkLine()) {
+        if (readHeads.isCrossfading())
+          processNetworkRun<Sample, Interp, Format, true>(samples + i, nullptr, run);
+        else
+          processNetworkRun<Sample, Interp, Format, false>(samples + i, nullptr, run);
+      } else {
+        const bool general = readHeads.isCrossfading() || kernel == Kernel::Reference;
+        dispatchPath<false>(general, [&](auto path) {
+          processMonoRun<Sample, Interp, Format, decltype(path)>(samples + i, run);
+        });
+
+        // Mono has no cross-feed to ramp; the mix still settles so a layout change can go on
+        pingPongMix.skip(run);
+      }
+
+      if (numTapGroups > 0)
+        processTapsRun<Sample, Interp, Format>(samples + i, nullptr, run);
+      i += run;
+    }
+  });
+}
+
+template <typename Sample>
+void Delay::processStereo(Sample* left, Sample* right, int numSamples) {
+  adoptPendingDelayLine(numSamples);
+  delayLine->cleanAhead();
+
+  Sample* channels[] = {left, right};
+  if (skipIfIdle(channels, 2, numSamples))
+    return;
+
+  dispatch([&](auto policy, auto format) {
+    using Interp = decltype(policy);
+    using Format = decltype(format);
+
+    for (int i = 0; i < numSamples;) {
+      int run = getRunLength(numSamples - i);
+      const bool general = readHeads.isCrossfading() || fadeInAmount < 1.0f ||
+                           pingPongMix.isSmoothing() || kernel == Kernel::Reference;
+      beginRun();
+
+      if (isNetworkLine()) {
+        if (readHeads.isCrossfading())
+          processNetworkRun<Sample, Interp, Format, true>(left + i, right + i, run);
+        else
+          processNetworkRun<Sample, Interp, Format, false>(left + i, right + i, run);
+      } else {
+        dispatchPath<true>(general, [&](auto path) {
+          using Path = decltype(path);
+
+          // The allpass recursion runs sample by sample, and the vector kernel computes in
+          // float, so both the allpass and a double-precision line take the scalar kernel
+          if constexpr (!Interp::recursive && std::is_same_v<typename Format::Real, float>) {
+            if (kernel == Kernel::Simd) {
+              processStereoSimdRun<Sample, Interp, Format, Path>(left + i, right + i, run);
+              return;
+            }
+          }
+          processStereoScalarRun<Sample, Interp, Format, Path>(left + i, right + i, run);
+        });
+      }
+
+      if (numTapGroups > 0)
+        processTapsRun<Sample, Interp, Format>(left + i, right + i, run);
+      i += run;
+    }
+  });
+}
+
+template <typename Sample>
+void Delay::processMultichannel(Sample* const* channels, int numSamples) {
+  adoptPendingDelayLine(numSamples);
+  delayLine->cleanAhead();
+
+  jassert(numChannels > 2 && numLanes % 4 == 0);
+
+  if (skipIfIdle(channels, numChannels, numSamples))
+    return;
+
+  dispatch([&](auto policy, auto format) {
+    using Interp = decltype(policy);
+    using Format = decltype(format);
+
+    for (int i = 0; i < numSamples;) {
+      int run = getRunLength(numSamples - i);
+      bool crossfade = readHeads.isCrossfading();
+      beginRun();
+
+      if (crossfade)
+        processMultichannelRun<Sample, Interp, Format, true>(channels, i, run);
+      else
+        processMultichannelRun<Sample, Interp, Format, false>(channels, i, run);
+      i += run;
+    }
+  });
+}
+
+template <typename Interp, typename Format>
+typename Format::Real Delay::read(float delaySamples,
+                                  size_t channel,
+                                  typename Format::Real& state) const {
+  using Real = typename Format::Real;
+  const auto& line = getLine<Format>();
+  constexpr float minDelay = static_cast<float>(std::max(1, Interp::firstTap + Interp::taps - 1));
+  const float maxDelay = static_cast<float>(line.getReadableDelay() - 2);
+
+  delaySamples = std::clamp(delaySamples, minDelay, maxDelay);
+  size_t whole = static_cast<size_t>(delaySamples);
+  float t = 1.0f - (delaySamples - static_cast<float>(whole));
+
+  float w[4] = {};
+  float coefficient = Interp::weights(t, w);
+
+  // Taps are contiguous (oldest first) thanks to the delay line's guard region
+  const size_t stride = line.getNumChannels();
+  const auto* tap = line.getFrame(whole + 1 - Interp::firstTap) + channel;
+
+  Real out = 0.0f;
+  for (int j = 0; j < Interp::taps; ++j)
+    out += w[j] * Format::toReal(tap[static_cast<size_t>(j) * stride]);
+
+  if constexpr (Interp::recursive) {
+    out -= coefficient * state;
+    state = out;
+  } else {
+    juce::ignoreUnused(coefficient, state);
+  }
+  return out;
+}
+
+template <typename Interp, typename Format>
+simd::Float4 Delay::readLanes(const float* delays, size_t firstLane, float* state) const {
+  using simd::Float4;
+
+  const auto& line = getLine<Format>();
+  constexpr float minDelay = static_cast<float>(std::max(1, Interp::firstTap + Interp::taps - 1));
+  const float maxDelay = static_cast<float>(line.getReadableDelay() - 2);
+  const size_t stride = line.getNumChannels();
+
+  float w[4][4];  // [lane][tap]
+  float coefficient[4];
+  const typename Format::Sample* tap[4];
+
+  for (size_t l = 0; l < 4; ++l) {
+    float delaySamples = std::clamp(delays[l], minDelay, maxDelay);
+    size_t whole = static_cast<size_t>(delaySamples);
+    coefficient[l] = Interp::weights(1.0f - (delaySamples - static_cast<float>(whole)), w[l]);
+    tap[l] = line.getFrame(whole + 1 - Interp::firstTap) + firstLane + l;
+  }
+
+  Float4 sum;
+  for (int j = 0; j < Interp::taps; ++j) {
+    const size_t offset = static_cast<size_t>(j) * stride;
+    sum = sum + gather<Format>(tap, offset) * Float4{w[0][j], w[1][j], w[2][j], w[3][j]};
+  }
+
+  if constexpr (Interp::recursive) {
+    sum = sum - Float4::load(coefficient) * Float4::load(state);
+    sum.store(state);
+  } else {
+    juce::ignoreUnused(coefficient, state);
+  }
+  return sum;
+}
+
+template <typename Sample, typename Interp, typename Format, typename Path>
+void Delay::processMonoRun(Sample* samples, int numSamples) {
+  using Real = typename Format::Real;
+  auto& line = getLine<Format>();
+  const float sr = static_cast<float>(sampleRate);
 
   for (int i = 0; i < numSamples; ++i) {
-    float mod = std::sin(modPhase * juce::MathConstants<float>::twoPi) * (modDepth / 100);
-    size_t delaySamples = static_cast<size_t>((delayTimeSeconds + mod) * sampleRate);
-    size_t readIndex = (writeIndex + buf.size() - delaySamples) % buf.size();
+    float delaySamples = readHeads.getDelay();
+    float previousDelay = readHeads.getPreviousDelay();
+    if constexpr (Path::modulated) {
+      float mod = lfo.next() * modDepth.getNextValue() * sr;
+      delaySamples += mod;
+      previousDelay += mod;
+    }
 
-    float delayed = buf[readIndex];
-    float filtered = hiCutFilterL.processSample(delayed);
-    float input = samples[i];
-    float output = dryLevel * input + wetLevel * filtered;
+    Real delayed = read<Interp, Format>(delaySamples, 0, getAllpassState<Real>(0, 0));
+    if constexpr (Path::general) {
+      float fade = readHeads.getFade();
+      Real previous = read<Interp, Format>(previousDelay, 0, getAllpassState<Real>(1, 0));
+      delayed = delayed * fade + previous * (1.0f - fade);
+    }
 
-    samples[i] = output;
-    buf[writeIndex] = input + filtered * feedback;
+    Real filtered = delayed;
+    if constexpr (Path::filtered) {
+      filter.tick();
+      filtered = filter.process(delayed, 0);
+    }
+    Real input = static_cast<Real>(samples[i]);
+    Real output = dryLevel.getNextValue() * input + wetLevel.getNextValue() * filtered;
 
-    writeIndex = (writeIndex + 1) % buf.size();
-    modPhase = std::fmod(modPhase + modRate / static_cast<float>(sampleRate), 1.0f);
+    samples[i] = static_cast<Sample>(output);
+    line.getWriteFrame()[0] =
+        Format::fromReal(input + filtered * feedback.getNextValue(), line.getDither());
+
+    line.advance();
+    readHeads.advance();
   }
+
+  advanceDroppedStages<Path>(numSamples);
 }
 
-void Delay::processStereo(float* left, float* right, int numSamples) {
-  auto& bufL = delayBuffer[0];
-  auto& bufR = delayBuffer[1];
-  const auto bufferSize = bufL.size();
+template <typename Sample, typename Interp, typename Format, typename Path>
+void Delay::processStereoScalarRun(Sample* left, Sample* right, int numSamples) {
+  using Real = typename Format::Real;
+  auto& line = getLine<Format>();
+  const float sr = static_cast<float>(sampleRate);
+
+  // The ping-pong side only moves on while it is heard, as in the steady PingPong path
+  const bool flips = pingPongMix.isSmoothing() || mode == DelayMode::PingPong;
 
   for (int i = 0; i < numSamples; ++i) {
-    float mod = std::sin(modPhase * juce::MathConstants<float>::twoPi) * (modDepth / 100.0f);
-    float delaySamples = static_cast<float>((delayTimeSeconds + mod) * sampleRate);
-    delaySamples = std::clamp(delaySamples, 1.0f, static_cast<float>(bufferSize - 2));
+    float dry = dryLevel.getNextValue();
+    float wet = wetLevel.getNextValue();
+    float fb = feedback.getNextValue();
 
-    // Interpolate between two samples in the delay buffer for smoother repeats
-    float readPos = static_cast<float>(writeIndex) + bufferSize - delaySamples;
-    while (readPos < 0.0f)
-      readPos += bufferSize;
-    size_t i0 = static_cast<size_t>(readPos) % bufferSize;
-    size_t i1 = (i0 + 1) % bufferSize;
-    float frac = readPos - std::floor(readPos);
+    float delaySamples = readHeads.getDelay();
+    float modL = 0.0f, modR = 0.0f;
+    if constexpr (Path::modulated) {
+      float depth = modDepth.getNextValue() * sr;
+      lfo.next(modL, modR);
+      modL *= depth;
+      modR *= depth;
+    }
 
-    // Linear interpolation
-    float delayedL = bufL[i0] * (1.0f - frac) + bufL[i1] * frac;
-    float delayedR = bufR[i0] * (1.0f - frac) + bufR[i1] * frac;
+    Real delayedL = read<Interp, Format>(delaySamples + modL, 0, getAllpassState<Real>(0, 0));
+    Real delayedR = read<Interp, Format>(delaySamples + modR, 1, getAllpassState<Real>(0, 1));
 
-    float filteredL = hiCutFilterL.processSample(delayedL);
-    float filteredR = hiCutFilterR.processSample(delayedR);
+    if constexpr (Path::general) {
+      float fade = readHeads.getFade();
+      float previous = readHeads.getPreviousDelay();
+      Real previousL = read<Interp, Format>(previous + modL, 0, getAllpassState<Real>(1, 0));
+      Real previousR = read<Interp, Format>(previous + modR, 1, getAllpassState<Real>(1, 1));
+      delayedL = delayedL * fade + previousL * (1.0f - fade);
+      delayedR = delayedR * fade + previousR * (1.0f - fade);
+    }
+
+    Real filteredL = delayedL;
+    Real filteredR = delayedR;
+    if constexpr (Path::filtered) {
+      filter.tick();
+      filteredL = filter.process(delayedL, 0);
+      filteredR = filter.process(delayedR, 1);
+    }
 
-    float inL = left[i];
-    float inR = right[i];
+    Real inL = static_cast<Real>(left[i]);
+    Real inR = static_cast<Real>(right[i]);
 
     // Soften the attack of the delay using a fade-in
-    float fadeFactor = std::min(1.0f, fadeInAmount);
-    fadeInAmount += fadeInIncrement;
+    float fadeFactor = 1.0f;
+    if constexpr (Path::general) {
+      fadeFactor = std::min(1.0f, fadeInAmount);
+      fadeInAmount += fadeInIncrement;
+    }
 
-    if (mode == DelayMode::PingPong) {
-      left[i] = dryLevel * inL + wetLevel * filteredL * fadeFactor;
-      right[i] = dryLevel * inR + wetLevel * filteredR * fadeFactor;
+    left[i] = static_cast<Sample>(dry * inL + wet * filteredL * fadeFactor);
+    right[i] = static_cast<Sample>(dry * inR + wet * filteredR * fadeFactor);
 
+    Real frame[2];
+
+    if constexpr (Path::topology == Topology::Any) {
+      // Both topologies' writes, weighted by the mix. Reads are the same in every mode, so
+      // this is what two engines sharing the line's history would write during a
+      // crossfade, without running a second one. Once the mix settles it reduces to the
+      // mode's own write.
+      float mix = pingPongMix.getNextValue();
+      float direct = fb * (1.0f - mix);
+      float cross = fb * mix;
+      frame[0] = inL * (1.0f - mix * fb) + filteredL * direct;
+      frame[1] = inR * (1.0f - mix) + filteredR * direct;
+      if (pingPongFlip)
+        frame[1] += filteredL * cross;
+      else
+        frame[0] += filteredR * cross;
+
+      if (flips)
+        stepPingPong(delaySamples + modL);
+    } else if constexpr (Path::topology == Topology::PingPong) {
       // Inject input from one channel to start the ping-pong chain
-      bufL[writeIndex] = inL * (1.0f - feedback);
-      bufR[writeIndex] = 0.0f;
+      frame[0] = inL * (1.0f - fb);
+      frame[1] = 0.0f;
 
       // Cross-feed feedback
       if (pingPongFlip) {
-        bufR[writeIndex] += delayedL * feedback;
+        frame[1] += filteredL * fb;
       } else {
-        bufL[writeIndex] += delayedR * feedback;
+        frame[0] += filteredR * fb;
       }
 
       // Flip once per full repeat/delay time
-      if (--samplesUntilNextFlip <= 0) {
-        pingPongFlip = !pingPongFlip;
-        samplesUntilNextFlip = static_cast<size_t>(delaySamples);
+      stepPingPong(delaySamples + modL);
+    } else {
+      frame[0] = inL + filteredL * fb;
+      frame[1] = inR + filteredR * fb;
+    }
+
+    auto* written = line.getWriteFrame();
+    written[0] = Format::fromReal(frame[0], line.getDither());
+    written[1] = Format::fromReal(frame[1], line.getDither());
+    line.advance();
+    readHeads.advance();
+  }
+
+  advanceDroppedStages<Path>(numSamples);
+}
+
+/**
+ * Vectorized stereo kernel
+ *
+ * Works on two frames per iteration, each register holding [L0 R0 L1 R1]. Because the
+ * buffer is interleaved, each load fetches two neighbouring taps of both channels, so a
+ * linear read is one load per frame and a 4-point read two. Mode differences are
+ * expressed as per-lane gains for the feedback write (input, direct and cross-fed delayed
+ * signal), so the mix and write are branch-free; the steady topologies only compute the
+ * gains they use. The feedback filter is recursive per sample, so it takes one frame per
+ * vector pass, with two lanes idle.
+ */
+template <typename Sample, typename Interp, typename Format, typename Path>
+void Delay::processStereoSimdRun(Sample* left, Sample* right, int numSamples) {
+  using simd::Float4;
+  static_assert(!Interp::recursive, "Recursive interpolators need the scalar kernel");
+
+  auto& line = getLine<Format>();
+  const float sr = static_cast<float>(sampleRate);
+  const bool splitChannels = Path::modulated && wideModulation;
+  const bool flips = pingPongMix.isSmoothing() || mode == DelayMode::PingPong;
+
+  // Two frames are written per iteration, so the second one must not read the first one
+  constexpr int newestTap = Interp::firstTap + Interp::taps - 1;
+  constexpr float minDelay = static_cast<float>(std::max(1, newestTap) + 1);
+  const float maxDelay = static_cast<float>(line.getReadableDelay() - 2);
+
+  // Loads covering the taps of one channel pair, padded with zero weights
+  constexpr int loads = (Interp::taps + 1) / 2;
+
+  // Reads one head for frame `k` of the pair, summed per load into
+  // [even taps L, even taps R, odd taps L, odd taps R] and scaled by `gain`
+  auto readWeighted = [&](float delayL, float delayR, size_t k, float gain) {
+    auto weigh = [&](float delaySamples, Float4 mask) {
+      delaySamples = std::clamp(delaySamples, minDelay, maxDelay);
+      size_t whole = static_cast<size_t>(delaySamples);
+      float t = 1.0f - (delaySamples - static_cast<float>(whole));
+
+      float w[4] = {};
+      Interp::weights(t, w);
+
+      const auto* tap = line.getFrame(whole + 1 - Interp::firstTap - k);
+      Float4 sum = Format::load(tap) * Float4{w[0], w[0], w[1], w[1]};
+      for (int j = 1; j < loads; ++j)
+        sum = sum + Format::load(tap + 4 * j) *
+                        Float4{w[2 * j], w[2 * j], w[2 * j + 1], w[2 * j + 1]};
+      return sum * mask;
+    };
+
+    if (!splitChannels)
+      return weigh(delayL, Float4{gain});
+
+    // The right channel reads at its own position; mask each read to its channel
+    return weigh(delayL, Float4{gain, 0.0f, gain, 0.0f}) +
+           weigh(delayR, Float4{0.0f, gain, 0.0f, gain});
+  };
+
+  int i = 0;
+  for (; i + 1 < numSamples; i += 2) {
+    // Per-frame gains; smoothed parameters advance once per frame as in the scalar kernel
+    float dry[2], wetFade[2], fbs[2], directGain[2];
+    float inGain[2][2], crossGain[2][2];
+    Float4 weighted[2];
+
+    for (int k = 0; k < 2; ++k) {
+      dry[k] = dryLevel.getNextValue();
+      float wet = wetLevel.getNextValue();
+      float fb = feedback.getNextValue();
+      fbs[k] = fb;
+
+      float delaySamples = readHeads.getDelay();
+      float modL = 0.0f, modR = 0.0f;
+      if constexpr (Path::modulated) {
+        float depth = modDepth.getNextValue() * sr;
+        lfo.next(modL, modR);
+        modL *= depth;
+        modR *= depth;
+      }
+
+      // The second frame of the pair sits one sample closer to the write head
+      size_t frame = static_cast<size_t>(k);
+      if constexpr (Path::general) {
+        float fade = readHeads.getFade();
+        float previous = readHeads.getPreviousDelay();
+        weighted[k] = readWeighted(delaySamples + modL, delaySamples + modR, frame, fade) +
+                      readWeighted(previous + modL, previous + modR, frame, 1.0f - fade);
+
+        wetFade[k] = wet * std::min(1.0f, fadeInAmount);
+        fadeInAmount += fadeInIncrement;
+      } else {
+        weighted[k] = readWeighted(delaySamples + modL, delaySamples + modR, frame, 1.0f);
+        wetFade[k] = wet;
+      }
+
+      if constexpr (Path::topology == Topology::Any) {
+        // The scalar kernel's blend of both topologies, as gains
+        float mix = pingPongMix.getNextValue();
+        inGain[k][0] = 1.0f - mix * fb;
+        inGain[k][1] = 1.0f - mix;
+        directGain[k] = fb * (1.0f - mix);
+        crossGain[k][0] = pingPongFlip ? 0.0f : fb * mix;
+        crossGain[k][1] = pingPongFlip ? fb * mix : 0.0f;
+
+        if (flips)
+          stepPingPong(delaySamples + modL);
+      } else if constexpr (Path::topology == Topology::PingPong) {
+        inGain[k][0] = 1.0f - fb;
+        inGain[k][1] = 0.0f;
+        crossGain[k][0] = pingPongFlip ? 0.0f : fb;
+        crossGain[k][1] = pingPongFlip ? fb : 0.0f;
+
+        stepPingPong(delaySamples + modL);
       }
+
+      readHeads.advance();
+    }
+
+    // Sum the even and odd tap halves of both frames
+    Float4 delayed = Float4::combineLow(weighted[0], weighted[1]) +
+                     Float4::combineHigh(weighted[0], weighted[1]);
+
+    // One pass through the filter sections per frame, with both channels in the low lanes
+    Float4 filtered = delayed;
+    if constexpr (Path::filtered) {
+      filter.tick();
+      Float4 first = filter.process(Float4::combineLow(delayed, Float4{}), 0);
+      filter.tick();
+      Float4 second = filter.process(Float4::combineHigh(delayed, Float4{}), 0);
+      filtered = Float4::combineLow(first, second);
+    }
+
+    Float4 in{static_cast<float>(left[i]), static_cast<float>(right[i]),
+              static_cast<float>(left[i + 1]), static_cast<float>(right[i + 1])};
+    Float4 out = Float4{dry[0], dry[0], dry[1], dry[1]} * in +
+                 filtered * Float4{wetFade[0], wetFade[0], wetFade[1], wetFade[1]};
+
+    Float4 write;
+    if constexpr (Path::topology == Topology::Any) {
+      write = in * Float4{inGain[0][0], inGain[0][1], inGain[1][0], inGain[1][1]} +
+              filtered * Float4{directGain[0], directGain[0], directGain[1], directGain[1]} +
+              Float4::swapPairs(filtered) *
+                  Float4{crossGain[0][0], crossGain[0][1], crossGain[1][0], crossGain[1][1]};
+    } else if constexpr (Path::topology == Topology::PingPong) {
+      juce::ignoreUnused(fbs, directGain);
+      write = in * Float4{inGain[0][0], inGain[0][1], inGain[1][0], inGain[1][1]} +
+              Float4::swapPairs(filtered) *
+                  Float4{crossGain[0][0], crossGain[0][1], crossGain[1][0], crossGain[1][1]};
     } else {
-      left[i] = dryLevel * inL + wetLevel * filteredL * fadeFactor;
-      right[i] = dryLevel * inR + wetLevel * filteredR * fadeFactor;
+      juce::ignoreUnused(directGain, inGain, crossGain);
+      write = in + filtered * Float4{fbs[0], fbs[0], fbs[1], fbs[1]};
+    }
+
+    float o[4];
+    out.store(o);
+
+    left[i] = o[0];
+    right[i] = o[1];
+    left[i + 1] = o[2];
+    right[i + 1] = o[3];
+
+    // Both frames convert at once; the second is moved into place after the first advance
+    typename Format::Sample w[4];
+    Format::store(w, write, line.getDither());
+    for (int k = 0; k < 2; ++k) {
+      auto* frame = line.getWriteFrame();
+      frame[0] = w[k * 2];
+      frame[1] = w[k * 2 + 1];
+      line.advance();
+    }
+  }
+
+  advanceDroppedStages<Path>(i);
+
+  // Odd trailing sample
+  if (i < numSamples)
+    processStereoScalarRun<Sample, Interp, Format, Path>(left + i, right + i, numSamples - i);
+}
+
+/**
+ * Multi-tap pass
+ *
+ * Runs after the kernel has written a run, reading that run back: frame i of it is now
+ * `numSamples - i` frames behind the write head, so a tap `d` samples behind it reads
+ * `d + numSamples - i` back. Runs are at most tapRunLength long, which bounds how much
+ * further back that reaches. Taps are processed four at a time, one per lane: each lane
+ * gathers its own taps from the one line, the weighting and gains are vector operations,
+ * and the lanes are only summed once per output sample. The sum goes through its own
+ * filter states and the wet level, so taps sound like the main repeats; they do not feed
+ * back. Delays and gains follow their ramps linearly across the run.
+ */
+template <typename Sample, typename Interp, typename Format>
+void Delay::processTapsRun(Sample* left, Sample* right, int numSamples) {
+  using simd::Float4;
+  using Real = typename Format::Real;
+
+  const auto& line = getLine<Format>();
+  const size_t stride = line.getNumChannels();
+  const size_t numOutputs = right != nullptr ? 2 : 1;
+  const size_t numTaps = numTapGroups * 4;
+  const float runLength = static_cast<float>(numSamples);
+
+  constexpr float minDelay = static_cast<float>(std::max(1, Interp::firstTap + Interp::taps - 1));
+  const float maxDelay = static_cast<float>(line.getReadableDelay() - 2);
+
+  // Values at sample i are start + slope * (i + 1); mono takes the mean of both sides
+  float delayStart[maxTaps], delaySlope[maxTaps];
+  float gainStart[2][maxTaps], gainSlope[2][maxTaps];
+  for (size_t t = 0; t < numTaps; ++t) {
+    delayStart[t] = tapDelays[t].getCurrentValue();
+    delaySlope[t] = (tapDelays[t].skip(numSamples) - delayStart[t]) / runLength;
+
+    float start[2], end[2];
+    for (size_t side = 0; side < 2; ++side) {
+      start[side] = tapGains[side][t].getCurrentValue();
+      end[side] = tapGains[side][t].skip(numSamples);
+    }
+    if (numOutputs == 1) {
+      start[0] = 0.5f * (start[0] + start[1]);
+      end[0] = 0.5f * (end[0] + end[1]);
+    }
+    for (size_t c = 0; c < numOutputs; ++c) {
+      gainStart[c][t] = start[c];
+      gainSlope[c][t] = (end[c] - start[c]) / runLength;
+    }
+  }
+
+  const float wet = wetLevel.getCurrentValue();
+  Sample* outputs[] = {left, right};
+
+  for (int i = 0; i < numSamples; ++i) {
+    const float age = static_cast<float>(numSamples - i);
+    const Float4 ramp{static_cast<float>(i + 1)};
+    Float4 sum[2];
+
+    for (size_t first = 0; first < numTaps; first += 4) {
+      float delays[4];
+      (Float4::load(delayStart + first) + Float4::load(delaySlope + first) * ramp + Float4{age})
+          .store(delays);
+
+      float w[4][4];  // [lane][tap]
+      float coefficient[4];
+      const typename Format::Sample* tap[4];
+      for (size_t l = 0; l < 4; ++l) {
+        float delaySamples = std::clamp(delays[l], minDelay, maxDelay);
+        size_t whole = static_cast<size_t>(delaySamples);
+        coefficient[l] = Interp::weights(1.0f - (delaySamples - static_cast<float>(whole)), w[l]);
+        tap[l] = line.getFrame(whole + 1 - Interp::firstTap);
+      }
 
-      bufL[writeIndex] = inL + delayedL * feedback;
-      bufR[writeIndex] = inR + delayedR * feedback;
+      for (size_t c = 0; c < numOutputs; ++c) {
+        Float4 delayed;
+        for (int j = 0; j < Interp::taps; ++j) {
+          const size_t offset = static_cast<size_t>(j) * stride + c;
+          delayed = delayed + gather<Format>(tap, offset) *
+                                  Float4{w[0][j], w[1][j], w[2][j], w[3][j]};
+        }
+
+        if constexpr (Interp::recursive) {
+          float* state = tapAllpassState[c] + first;
+          delayed = delayed - Float4::load(coefficient) * Float4::load(state);
+          delayed.store(state);
+        } else {
+          juce::ignoreUnused(coefficient);
+        }
+
+        Float4 gain =
+            Float4::load(gainStart[c] + first) + Float4::load(gainSlope[c] + first) * ramp;
+        sum[c] = sum[c] + delayed * gain;
+      }
     }
 
-    writeIndex = (writeIndex + 1) % bufferSize;
-    modPhase = std::fmod(modPhase + modRate / static_cast<float>(sampleRate), 1.0f);
+    for (size_t c = 0; c < numOutputs; ++c) {
+      float lanes[4];
+      sum[c].store(lanes);
+      const float tapSum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+      // Added in the line's Real, as the rest of the mix: a line of doubles keeps the repeats
+      // they are added to in double precision, the others give double buffers the float result
+      const float tapOut = wet * filter.process(tapSum, tapFilterChannel + c);
+      outputs[c][i] = static_cast<Sample>(static_cast<Real>(outputs[c][i]) + tapOut);
+    }
   }
 }
+
+/**
+ * Multichannel kernel
+ *
+ * Frames hold one lane per channel, padded to a multiple of four, so a register covers
+ * four channels of one frame (structure of arrays across channels). Each lane reads at
+ * the base delay plus its channel offset and modulation (odd channels take the LFO's
+ * offset output). Settled offsets are whole samples, so unless the channels are
+ * modulated apart they share one fractional position and one set of weights: with no
+ * offsets a tap is a single load per four channels, otherwise a gather of four. While
+ * offsets ramp or the modulation is wide, each lane computes its own weights. The filter,
+ * mix and feedback write run four channels at a time as well.
+ */
+template <typename Sample, typename Interp, typename Format, bool Crossfade>
+void Delay::processMultichannelRun(Sample* const* channels, int start, int numSamples) {
+  using simd::Float4;
+
+  auto& line = getLine<Format>();
+  const float sr = static_cast<float>(sampleRate);
+  const size_t stride = numLanes;
+  const bool changingMode = pingPongMix.isSmoothing();
+  const bool perChannelWrite = changingMode || mode == DelayMode::PingPong;
+  const size_t numGroups = numLanes / 4;
+  const size_t numChannelsU = static_cast<size_t>(numChannels);
+  const bool shared = sharedFraction && kernel != Kernel::Reference;
+
+  constexpr float minDelay = static_cast<float>(std::max(1, Interp::firstTap + Interp::taps - 1));
+  const float maxDelay = static_cast<float>(line.getReadableDelay() - 2);
+  const size_t maxWhole = static_cast<size_t>(maxDelay);
+
+  // One head's position when all lanes share the fractional part
+  struct SharedRead {
+    size_t whole = 0;
+    float w[4] = {};
+    float coefficient = 0.0f;
+  };
+
+  auto prepareShared = [&](float delaySamples) {
+    SharedRead read;
+    delaySamples = std::clamp(delaySamples, minDelay, maxDelay);
+    read.whole = static_cast<size_t>(delaySamples);
+    read.coefficient =
+        Interp::weights(1.0f - (delaySamples - static_cast<float>(read.whole)), read.w);
+    return read;
+  };
+
+  // Reads lanes 4 * group .. 4 * group + 3; `state` is their allpass state
+  auto readShared = [&](const SharedRead& read, size_t group, float* state) {
+    const size_t lane = group * 4;
+    Float4 sum;
+
+    if (uniformLanes) {
+      const auto* tap = line.getFrame(read.whole + 1 - Interp::firstTap) + lane;
+      for (int j = 0; j < Interp::taps; ++j)
+        sum = sum + Format::load(tap + static_cast<size_t>(j) * stride) * Float4{read.w[j]};
+    } else {
+      const typename Format::Sample* tap[4];
+      for (size_t l = 0; l < 4; ++l) {
+        size_t whole = std::min(read.whole + laneOffsets[lane + l], maxWhole);
+        tap[l] = line.getFrame(whole + 1 - Interp::firstTap) + lane + l;
+      }
+
+      for (int j = 0; j < Interp::taps; ++j) {
+        const size_t offset = static_cast<size_t>(j) * stride;
+        sum = sum + gather<Format>(tap, offset) *
+                        Float4{read.w[j]};
+      }
+    }
+
+    if constexpr (Interp::recursive) {
+      sum = sum - Float4{read.coefficient} * Float4::load(state);
+      sum.store(state);
+    } else {
+      juce::ignoreUnused(state);
+    }
+    return sum;
+  };
+
+  float delays[maxChannels], previousDelays[maxChannels];
+  float inputs[maxChannels] = {}, filteredLanes[maxChannels];
+
+  for (int i = start; i < start + numSamples; ++i) {
+    Float4 dry{dryLevel.getNextValue()};
+    float wet = wetLevel.getNextValue();
+    float fb = feedback.getNextValue();
+    float depth = modDepth.getNextValue() * sr;
+
+    float modA, modB;
+    lfo.next(modA, modB);
+
+    Float4 wetFade{wet * std::min(1.0f, fadeInAmount)};
+    fadeInAmount += fadeInIncrement;
+
+    for (size_t c = 0; c < numChannelsU; ++c)
+      inputs[c] = static_cast<float>(channels[c][i]);
+
+    filter.tick();
+
+    SharedRead current, previous;
+    if (shared) {
+      current = prepareShared(readHeads.getDelay() + modA * depth);
+      if constexpr (Crossfade)
+        previous = prepareShared(readHeads.getPreviousDelay() + modA * depth);
+    } else {
+      for (size_t c = 0; c < numLanes; ++c) {
+        float offset = c < numChannelsU ? channelOffsets[c].getNextValue() : 0.0f;
+        float mod = ((c & 1) != 0 ? modB : modA) * depth;
+        delays[c] = readHeads.getDelay() + offset + mod;
+        previousDelays[c] = readHeads.getPreviousDelay() + offset + mod;
+      }
+    }
+
+    for (size_t g = 0; g < numGroups; ++g) {
+      const size_t lane = g * 4;
+
+      Float4 delayed =
+          shared ? readShared(current, g, allpassState[0] + lane)
+                 : readLanes<Interp, Format>(delays + lane, lane, allpassState[0] + lane);
+      if constexpr (Crossfade) {
+        float fade = readHeads.getFade();
+        Float4 fading =
+            shared ? readShared(previous, g, allpassState[1] + lane)
+                   : readLanes<Interp, Format>(previousDelays + lane, lane, allpassState[1] + lane);
+        delayed = delayed * Float4{fade} + fading * Float4{1.0f - fade};
+      }
+
+      Float4 filtered = filter.process(delayed, lane);
+
+      Float4 in = Float4::load(inputs + lane);
+      float out[4];
+      (dry * in + wetFade * filtered).store(out);
+      for (size_t l = 0; l < 4 && lane + l < numChannelsU; ++l)
+        channels[lane + l][i] = out[l];
+
+      filtered.store(filteredLanes + lane);
+      if (!perChannelWrite)
+        Format::store(line.getWriteFrame() + lane, in + filtered * Float4{fb}, line.getDither());
+    }
+
+    if (changingMode) {
+      // Each channel feeds back a blend of itself and its neighbour, see
+      // processStereoScalarRun
+      const float mix = pingPongMix.getNextValue();
+      const float direct = fb * (1.0f - mix);
+      const float cross = fb * mix;
+
+      auto* frame = line.getWriteFrame();
+      for (size_t c = 0; c < numChannelsU; ++c)
+        frame[c] = Format::fromFloat(
+            inputs[c] + filteredLanes[c] * direct +
+                filteredLanes[(c + numChannelsU - 1) % numChannelsU] * cross,
+            line.getDither());
+    } else if (mode == DelayMode::PingPong) {
+      auto* frame = line.getWriteFrame();
+      for (size_t c = 0; c < numChannelsU; ++c)
+        frame[c] = Format::fromFloat(
+            inputs[c] + filteredLanes[(c + numChannelsU - 1) % numChannelsU] * fb,
+            line.getDither());
+    }
+
+    line.advance();
+    readHeads.advance();
+  }
+}
+
+/**
+ * Feedback delay network kernel (Diffuse mode)
+ *
+ * The line holds one lane per network line, so a frame is one register. Each line is a
+ * whole number of samples shorter than the delay time (about the fractions in
+ * networkRatios), modulated as the multichannel lanes are, and goes through its own filter
+ * states. As in processMultichannelRun, settled lines share the fractional part of the read
+ * position, one for the even lines and one for the odd ones, so a read is one set of
+ * weights per side and a gather of the four lines per tap; while the lengths ramp to a new
+ * delay time, each line computes its own weights.
+ *
+ * The feedback matrix is the 4x4 Hadamard matrix scaled by 1/2: orthogonal, so it keeps the
+ * energy the feedback gain leaves, and every line feeds all the others. It is two butterfly
+ * stages within the register. Left feeds the even lines and right the odd ones, and each
+ * side hears its lines' sum.
+ *
+ * Diffusion blends the routing from the Stereo mode's to the network's: the feedback from
+ * the delayed lines themselves to the filtered lines through the matrix, the input of lines
+ * 2 and 3 from nothing, and the outputs from lines 0 and 1 to the sums. Both ends keep the
+ * feedback within its gain, so the blend is stable too. With no diffusion this is the
+ * Stereo kernel on lanes 0 and 1, which is where the line's layout changes (see
+ * adoptPendingDelayLine). Mono buffers (`right` null) feed both sides and hear their mean.
+ */
+template <typename Sample, typename Interp, typename Format, bool Crossfade>
+void Delay::processNetworkRun(Sample* left, Sample* right, int numSamples) {
+  using simd::Float4;
+
+  auto& line = getLine<Format>();
+  const float sr = static_cast<float>(sampleRate);
+  const bool shared = networkSharedFraction && kernel != Kernel::Reference;
+
+  constexpr float minDelay = static_cast<float>(std::max(1, Interp::firstTap + Interp::taps - 1));
+  const float maxDelay = static_cast<float>(line.getReadableDelay() - 2);
+  constexpr size_t minWhole = static_cast<size_t>(minDelay);
+
+  // One head's position for the even or the odd lines
+  struct SharedRead {
+    size_t whole = 0;
+    float w[4] = {};
+    float coefficient = 0.0f;
+  };
+
+  auto prepareShared = [&](float delaySamples) {
+    SharedRead read;
+    delaySamples = std::clamp(delaySamples, minDelay, maxDelay);
+    read.whole = static_cast<size_t>(delaySamples);
+    read.coefficient =
+        Interp::weights(1.0f - (delaySamples - static_cast<float>(read.whole)), read.w);
+    return read;
+  };
+
+  // Reads all lines, the even ones at `even` and the odd ones at `odd`. The odd lines usually
+  // read at `even` too, passed by reference rather than copied: a copy of the just-written
+  // weights would stall on store forwarding at every sample.
+  auto readShared = [&](const SharedRead& even, const SharedRead& odd, float* state) {
+    const SharedRead* reads[2] = {&even, &odd};
+    const typename Format::Sample* tap[4];
+    for (size_t l = 0; l < 4; ++l) {
+      const size_t whole = reads[l & 1]->whole;
+      const size_t shorter = networkShortening[l];
+      tap[l] = line.getFrame((whole > shorter + minWhole ? whole - shorter : minWhole) + 1 -
+                             Interp::firstTap) +
+               l;
+    }
+
+    Float4 sum;
+    for (int j = 0; j < Interp::taps; ++j) {
+      const size_t offset = static_cast<size_t>(j) * networkLines;
+      sum = sum + gather<Format>(tap, offset) * Float4{even.w[j], odd.w[j], even.w[j], odd.w[j]};
+    }
+
+    if constexpr (Interp::recursive) {
+      const Float4 coefficient{even.coefficient, odd.coefficient, even.coefficient,
+                               odd.coefficient};
+      sum = sum - coefficient * Float4::load(state);
+      sum.store(state);
+    } else {
+      juce::ignoreUnused(state);
+    }
+    return sum;
+  };
+
+  const Float4 alternate{1.0f, -1.0f, 1.0f, -1.0f};
+  const Float4 halves{1.0f, 1.0f, -1.0f, -1.0f};
+
+  float delays[networkLines], previousDelays[networkLines];
+
+  for (int i = 0; i < numSamples; ++i) {
+    Float4 dry{dryLevel.getNextValue()};
+    float wet = wetLevel.getNextValue();
+    float fb = feedback.getNextValue();
+    float depth = modDepth.getNextValue() * sr;
+    float d = diffusion.getNextValue();
+
+    Float4 wetFade{wet * std::min(1.0f, fadeInAmount)};
+    fadeInAmount += fadeInIncrement;
+
+    float modA, modB;
+    lfo.next(modA, modB);
+
+    filter.tick();
+
+    Float4 delayed;
+    if (shared) {
+      // The odd lines only read apart when the modulation is wide
+      SharedRead current = prepareShared(readHeads.getDelay() + modA * depth);
+      SharedRead currentOdd;
+      if (wideModulation)
+        currentOdd = prepareShared(readHeads.getDelay() + modB * depth);
+      delayed = readShared(current, wideModulation ? currentOdd : current, allpassState[0]);
+      if constexpr (Crossfade) {
+        SharedRead previous = prepareShared(readHeads.getPreviousDelay() + modA * depth);
+        SharedRead previousOdd;
+        if (wideModulation)
+          previousOdd = prepareShared(readHeads.getPreviousDelay() + modB * depth);
+        float fade = readHeads.getFade();
+        delayed = delayed * Float4{fade} +
+                  readShared(previous, wideModulation ? previousOdd : previous, allpassState[1]) *
+                      Float4{1.0f - fade};
+      }
+    } else {
+      // Shortened after the modulation, so settled lines land where the shared reads do
+      for (size_t l = 0; l < networkLines; ++l) {
+        float mod = ((l & 1) != 0 ? modB : modA) * depth;
+        float shorter = networkOffsets[l].getNextValue();
+        delays[l] = readHeads.getDelay() + mod - shorter;
+        previousDelays[l] = readHeads.getPreviousDelay() + mod - shorter;
+      }
+      delayed = readLanes<Interp, Format>(delays, 0, allpassState[0]);
+      if constexpr (Crossfade) {
+        float fade = readHeads.getFade();
+        delayed = delayed * Float4{fade} +
+                  readLanes<Interp, Format>(previousDelays, 0, allpassState[1]) *
+                      Float4{1.0f - fade};
+      }
+    }
+
+    Float4 filtered = filter.process(delayed, 0);
+
+    const float inL = static_cast<float>(left[i]);
+    const float inR = right != nullptr ? static_cast<float>(right[i]) : inL;
+    const Float4 in{inL, inR, inL, inR};
+
+    // Each side's lines summed into [L R L R], over the square root of their number
+    Float4 sums = Float4::combineLow(filtered, filtered) + Float4::combineHigh(filtered, filtered);
+    Float4 wetOut = filtered * Float4{1.0f - d} + sums * Float4{0.70710678f * d};
+
+    float out[4];
+    (dry * in + wetFade * wetOut).store(out);
+    if (right != nullptr) {
+      left[i] = out[0];
+      right[i] = out[1];
+    } else {
+      left[i] = 0.5f * (out[0] + out[1]);
+    }
+
+    // Hadamard matrix: [x0 + x1, x0 - x1, x2 + x3, x2 - x3], then the same across the pairs
+    Float4 mixed = filtered * alternate + Float4::swapPairs(filtered);
+    mixed = Float4::combineLow(mixed, mixed) + Float4::combineHigh(mixed, mixed) * halves;
+
+    Float4 write = in * Float4{1.0f, 1.0f, d, d} + filtered * Float4{fb * (1.0f - d)} +
+                   mixed * Float4{0.5f * fb * d};
+
+    Format::store(line.getWriteFrame(), write, line.getDither());
+    line.advance();
+    readHeads.advance();
+  }
+}
+
+template void Delay::processMono(float*, int);
+template void Delay::processMono(double*, int);
+template void Delay::processStereo(float*, float*, int);
+template void Delay::processStereo(double*, double*, int);
+template void Delay::processMultichannel(float* const*, int);
+template void Delay::processMultichannel(double* const*, int);
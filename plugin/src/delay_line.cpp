@@ -0,0 +1,109 @@
+#include "delay_line.h"
+#include <algorithm>
+
+void DelayLine::prepare(size_t minDelayFrames, size_t newNumChannels) {
+  size_t newLength = 1;
+  while (newLength < minDelayFrames + guardFrames + 1)
+    newLength <<= 1;
+
+  writeIndex = 0;
+  framesWritten = 0;
+  preparedDelay = minDelayFrames;
+
+  if (newLength == length && newNumChannels == numChannels) {
+    cleanFrames = 0;
+    return;
+  }
+
+  numChannels = newNumChannels;
+  length = newLength;
+  mask = length - 1;
+  allocate(length + guardFrames);
+  cleanFrames = length;
+}
+
+void DelayLine::clear() {
+  zeroFrames(0, length + guardFrames);
+  writeIndex = 0;
+  framesWritten = 0;
+  cleanFrames = length;
+}
+
+void DelayLine::ensureClean(size_t delay) {
+  delay = std::min(delay, length);
+  if (delay > cleanFrames)
+    zeroStaleFrames(delay - cleanFrames);
+}
+
+void DelayLine::cleanAhead() {
+  if (cleanFrames == length)
+    return;
+
+  const size_t frames = std::max<size_t>(cleanBytesPerCall / (numChannels * sampleSize), 1);
+  zeroStaleFrames(std::min(frames, length - cleanFrames));
+}
+
+void DelayLine::zeroStaleFrames(size_t count) {
+  // Frames `cleanFrames + 1` .. `cleanFrames + count` behind the write head, oldest first
+  const size_t first = getIndex(cleanFrames + count);
+  const size_t beforeWrap = std::min(count, length - first);
+
+  zeroFrames(first, beforeWrap);
+  zeroFrames(0, count - beforeWrap);
+
+  refreshGuard();
+  cleanFrames += count;
+}
+
+void DelayLine::readFrameAt(size_t delay, float* out) const {
+  if (delay > cleanFrames || delay > getMaxDelay()) {
+    std::fill_n(out, numChannels, 0.0f);
+    return;
+  }
+  readFrame(getIndex(delay), out);
+}
+
+void DelayLine::beginHistoryFrom(const DelayLine& other, size_t frames) {
+  // Stale frames of `other` are not copied
+  frames = std::min({frames, length, other.length, other.cleanFrames});
+  historySource = &other;
+  historyStart = other.framesWritten - frames;
+  historyEnd = historyStart;
+  historyOverZeros = cleanFrames == length && framesWritten == 0;
+}
+
+bool DelayLine::copyHistory(size_t minFrames) {
+  const DelayLine& other = *historySource;
+
+  // Frames `other` has written over since the last call are gone; the history starts after them
+  const size_t reach = std::min(length, other.length);
+  if (other.framesWritten - historyEnd > reach) {
+    historyEnd = other.framesWritten - reach;
+    historyStart = historyEnd;
+    historyOverZeros = false;
+  }
+
+  // Frame n of either line is at index n & mask, oldest first, so the write head can go on
+  const size_t budget = std::max(cleanBytesPerCall / (numChannels * sampleSize), minFrames);
+  const size_t end = std::min(other.framesWritten, historyEnd + budget);
+  for (; historyEnd < end; ++historyEnd)
+    copyFrame(other, historyEnd & other.mask, historyEnd & mask);
+  if (historyEnd != other.framesWritten)
+    return false;
+
+  // Past the history the frames are as they were: zero in a new line, stale otherwise
+  const size_t copied = std::min(historyEnd - historyStart, length);
+  cleanFrames = historyOverZeros ? length : copied;
+  framesWritten = historyEnd;
+  writeIndex = framesWritten & mask;
+  refreshGuard();
+  return true;
+}
+
+std::unique_ptr<DelayLine> makeDelayLine(sample_format::Type format) {
+  std::unique_ptr<DelayLine> line;
+  sample_format::dispatch(format, [&](auto formatTag) {
+    line = std::make_unique<FormattedDelayLine<decltype(formatTag)>>();
+  });
+  return line;
+}
@@ -0,0 +1,118 @@
+#include "dsp_load.h"
+#include <algorithm>
+#include <cmath>
+
+void DspLoad::prepare(double sampleRate) {
+  nanosecondsPerSample = 1.0e9 / sampleRate;
+
+  numBlocks.store(0);
+  totalNanoseconds.store(0);
+  totalDeadlineNanoseconds.store(0);
+  maxNanoseconds.store(0);
+  maxLoad.store(0.0f);
+  xrunRiskBlocks.store(0);
+  for (auto& bin : bins)
+    bin.store(0);
+}
+
+void DspLoad::record(Clock::duration elapsed, int numSamples) {
+  if (numSamples <= 0)
+    return;
+
+  const auto nanoseconds = static_cast<uint64_t>(
+      std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+  const double deadline = nanosecondsPerSample * numSamples;
+  const auto load = static_cast<float>(static_cast<double>(nanoseconds) / deadline);
+
+  add(numBlocks, uint64_t{1});
+  add(totalNanoseconds, nanoseconds);
+  add(totalDeadlineNanoseconds, static_cast<uint64_t>(deadline));
+  if (nanoseconds > maxNanoseconds.load(std::memory_order_relaxed))
+    maxNanoseconds.store(nanoseconds, std::memory_order_relaxed);
+  if (load > maxLoad.load(std::memory_order_relaxed))
+    maxLoad.store(load, std::memory_order_relaxed);
+  if (load >= xrunRiskLoad)
+    add(xrunRiskBlocks, uint64_t{1});
+
+  const auto bin = static_cast<size_t>(std::min(load * binsPerDeadline, numBins - 1.0f));
+  add(bins[bin], uint32_t{1});
+}
+
+DspLoad::Stats DspLoad::getStats() const {
+  Stats stats;
+  stats.numBlocks = numBlocks.load(std::memory_order_relaxed);
+  if (stats.numBlocks == 0)
+    return stats;
+
+  const auto total = static_cast<double>(totalNanoseconds.load(std::memory_order_relaxed));
+  const auto totalDeadline =
+      static_cast<double>(totalDeadlineNanoseconds.load(std::memory_order_relaxed));
+  stats.meanMicroseconds = total / static_cast<double>(stats.numBlocks) * 1.0e-3;
+  stats.maxMicroseconds =
+      static_cast<double>(maxNanoseconds.load(std::memory_order_relaxed)) * 1.0e-3;
+  stats.meanLoad = totalDeadline > 0.0 ? total / totalDeadline : 0.0;
+  stats.maxLoad = maxLoad.load(std::memory_order_relaxed);
+  stats.xrunRiskBlocks = xrunRiskBlocks.load(std::memory_order_relaxed);
+
+  // Upper edge of the bin that holds the 99th percentile
+  std::array<uint32_t, numBins> counts;
+  uint64_t binned = 0;
+  for (size_t i = 0; i < counts.size(); ++i) {
+    counts[i] = bins[i].load(std::memory_order_relaxed);
+    binned += counts[i];
+  }
+  const auto rank = static_cast<uint64_t>(std::ceil(0.99 * static_cast<double>(binned)));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < counts.size(); ++i) {
+    seen += counts[i];
+    if (seen >= rank) {
+      stats.p99Load = static_cast<double>(i + 1) / binsPerDeadline;
+      break;
+    }
+  }
+  stats.p99Load = std::min(stats.p99Load, stats.maxLoad);
+
+  return stats;
+}
+
+juce::String DspLoad::Stats::toString() const {
+  return juce::String(static_cast<juce::int64>(numBlocks)) + " blocks, mean " +
+         juce::String(meanMicroseconds, 1) + " us (" + juce::String(meanLoad * 100.0, 1) +
+         "%), p99 " + juce::String(p99Load * 100.0, 0) + "%, max " +
+         juce::String(maxMicroseconds, 1) + " us (" + juce::String(maxLoad * 100.0, 1) +
+         "%), " + juce::String(static_cast<juce::int64>(xrunRiskBlocks)) +
+         " above the xrun risk load";
+}
+
+juce::var DspLoad::Stats::toVar() const {
+  auto* object = new juce::DynamicObject();
+  object->setProperty("numBlocks", static_cast<juce::int64>(numBlocks));
+  object->setProperty("meanMicroseconds", meanMicroseconds);
+  object->setProperty("maxMicroseconds", maxMicroseconds);
+  object->setProperty("meanLoad", meanLoad);
+  object->setProperty("p99Load", p99Load);
+  object->setProperty("maxLoad", maxLoad);
+  object->setProperty("xrunRiskBlocks", static_cast<juce::int64>(xrunRiskBlocks));
+  return juce::var(object);
+}
+
+DspLoadLogger::DspLoadLogger(const DspLoad& loadToLog, int intervalMs)
+    : juce::Thread("DSP load logger"), load(loadToLog), interval(intervalMs) {
+  startThread(juce::Thread::Priority::low);
+}
+
+DspLoadLogger::~DspLoadLogger() {
+  stopThread(1000);
+}
+
+void DspLoadLogger::run() {
+  while (!threadShouldExit()) {
+    wait(interval);
+    if (threadShouldExit())
+      break;
+
+    const auto stats = load.getStats();
+    if (stats.numBlocks > 0)
+      juce::Logger::writeToLog("[DSP load] " + stats.toString());
+  }
+}
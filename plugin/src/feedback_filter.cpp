@@ -0,0 +1,188 @@
+#include "feedback_filter.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// 1/Q of each section of the Butterworth low-pass of each slope, 2 sin((2k + 1) pi / 4N)
+// for section k of the 2N-pole prototype
+constexpr float invQ24[] = {0.76536686f, 1.84775907f};
+constexpr float invQ48[] = {0.39018064f, 1.11114047f, 1.66293922f, 1.96157056f};
+
+size_t getNumHiCutSections(FeedbackFilter::Slope slope) {
+  switch (slope) {
+    case FeedbackFilter::Slope::dB24:
+      return 2;
+    case FeedbackFilter::Slope::dB48:
+      return 4;
+    case FeedbackFilter::Slope::dB12:
+      break;
+  }
+  return 1;
+}
+}  // namespace
+
+void FeedbackFilter::prepare(double newSampleRate, double rampSeconds) {
+  sampleRate = newSampleRate;
+  cutoff.reset(sampleRate / updateInterval, rampSeconds);
+  lowCutoff.reset(sampleRate / updateInterval, rampSeconds);
+  samplesUntilUpdate = updateInterval;
+
+  if (hiCutActive)
+    computeHiCut(cutoff.getTargetValue());
+  if (lowCutActive)
+    computeLowCut(lowCutoff.getTargetValue());
+  reset();
+}
+
+void FeedbackFilter::reset() {
+  for (size_t s = 0; s < maxSections; ++s)
+    clearSection(s);
+}
+
+void FeedbackFilter::copyState(bool toDouble) {
+  for (size_t s = 0; s < maxSections; ++s) {
+    if (toDouble) {
+      std::copy_n(state1[s], maxChannels, preciseState1[s]);
+      std::copy_n(state2[s], maxChannels, preciseState2[s]);
+    } else {
+      for (size_t c = 0; c < maxChannels; ++c) {
+        state1[s][c] = static_cast<float>(preciseState1[s][c]);
+        state2[s][c] = static_cast<float>(preciseState2[s][c]);
+      }
+    }
+  }
+}
+
+void FeedbackFilter::clearSection(size_t section) {
+  std::fill_n(state1[section], maxChannels, 0.0f);
+  std::fill_n(state2[section], maxChannels, 0.0f);
+  std::fill_n(preciseState1[section], maxChannels, 0.0);
+  std::fill_n(preciseState2[section], maxChannels, 0.0);
+}
+
+void FeedbackFilter::setCutoff(float hz) {
+  if (!isValidCutoff(hz))
+    return;
+
+  if (!hiCutActive) {
+    hiCutActive = true;
+    cutoff.setCurrentAndTargetValue(hz);
+    computeHiCut(hz);
+    updateSections();
+    return;
+  }
+
+  cutoff.setTargetValue(hz);
+}
+
+void FeedbackFilter::setSlope(Slope newSlope) {
+  if (newSlope == slope)
+    return;
+
+  const size_t numBefore = getNumHiCutSections(slope);
+  slope = newSlope;
+  const size_t numAfter = getNumHiCutSections(slope);
+
+  for (size_t s = firstHiCutSection + numBefore; s < firstHiCutSection + numAfter; ++s)
+    clearSection(s);
+
+  if (hiCutActive)
+    computeHiCut(cutoff.getCurrentValue());
+  updateSections();
+}
+
+void FeedbackFilter::setLowCut(float hz) {
+  if (!isValidCutoff(hz)) {
+    if (lowCutActive) {
+      lowCutActive = false;
+      updateSections();
+    }
+    return;
+  }
+
+  if (!lowCutActive) {
+    lowCutActive = true;
+    lowCutoff.setCurrentAndTargetValue(hz);
+    clearSection(lowCutSection);
+    computeLowCut(hz);
+    updateSections();
+    return;
+  }
+
+  lowCutoff.setTargetValue(hz);
+}
+
+void FeedbackFilter::snapToCutoff() {
+  if (hiCutActive && cutoff.isSmoothing()) {
+    cutoff.setCurrentAndTargetValue(cutoff.getTargetValue());
+    computeHiCut(cutoff.getTargetValue());
+  }
+  if (lowCutActive && lowCutoff.isSmoothing()) {
+    lowCutoff.setCurrentAndTargetValue(lowCutoff.getTargetValue());
+    computeLowCut(lowCutoff.getTargetValue());
+  }
+}
+
+void FeedbackFilter::skip(int numSamples) {
+  while (numSamples >= samplesUntilUpdate) {
+    numSamples -= samplesUntilUpdate;
+    update();
+  }
+  samplesUntilUpdate -= numSamples;
+}
+
+void FeedbackFilter::update() {
+  samplesUntilUpdate = updateInterval;
+  if (cutoff.isSmoothing())
+    computeHiCut(cutoff.getNextValue());
+  if (lowCutoff.isSmoothing())
+    computeLowCut(lowCutoff.getNextValue());
+}
+
+void FeedbackFilter::updateSections() {
+  numSections = 0;
+  if (lowCutActive)
+    sections[numSections++] = lowCutSection;
+  if (hiCutActive) {
+    for (size_t k = 0; k < getNumHiCutSections(slope); ++k)
+      sections[numSections++] = firstHiCutSection + k;
+  }
+}
+
+void FeedbackFilter::computeHiCut(float hz) {
+  // Bilinear transform of the analog prototype, one section per pole pair
+  const float n =
+      1.0f / std::tan(juce::MathConstants<float>::pi * hz / static_cast<float>(sampleRate));
+  const float nSquared = n * n;
+
+  const float invQ12[] = {juce::MathConstants<float>::sqrt2};
+  const float* invQs = slope == Slope::dB48 ? invQ48 : slope == Slope::dB24 ? invQ24 : invQ12;
+
+  for (size_t k = 0; k < getNumHiCutSections(slope); ++k) {
+    const float invQ = invQs[k];
+    const float c1 = 1.0f / (1.0f + invQ * n + nSquared);
+
+    auto& c = coefficients[firstHiCutSection + k];
+    c.b0 = c1;
+    c.b1 = c1 * 2.0f;
+    c.b2 = c1;
+    c.a1 = c1 * 2.0f * (1.0f - nSquared);
+    c.a2 = c1 * (1.0f - invQ * n + nSquared);
+  }
+}
+
+void FeedbackFilter::computeLowCut(float hz) {
+  // As the hi-cut's 12 dB/oct section, with the numerator of the high-pass prototype
+  const float n =
+      1.0f / std::tan(juce::MathConstants<float>::pi * hz / static_cast<float>(sampleRate));
+  const float nSquared = n * n;
+  const float invQ = juce::MathConstants<float>::sqrt2;
+  const float c1 = 1.0f / (1.0f + invQ * n + nSquared);
+
+  auto& c = coefficients[lowCutSection];
+  c.b0 = c1 * nSquared;
+  c.b1 = -c1 * 2.0f * nSquared;
+  c.b2 = c1 * nSquared;
+  c.a1 = c1 * 2.0f * (1.0f - nSquared);
+  c.a2 = c1 * (1.0f - invQ * n + nSquared);
+}
@@ -0,0 +1,71 @@
+#include "lfo.h"
+#include <algorithm>
+#include <cmath>
+#include <juce_core/juce_core.h>
+
+void Lfo::setSampleRate(double newSampleRate) {
+  sampleRate = newSampleRate;
+  updateRotation();
+  reset();
+}
+
+void Lfo::setFrequency(float newFrequencyHz) {
+  if (newFrequencyHz == frequencyHz)
+    return;
+
+  frequencyHz = newFrequencyHz;
+  updateRotation();
+}
+
+void Lfo::setPhaseOffset(float newOffsetCycles) {
+  if (newOffsetCycles == offsetCycles)
+    return;
+
+  offsetCycles = newOffsetCycles;
+  offsetCos = std::cos(offsetCycles * juce::MathConstants<float>::twoPi);
+  offsetSin = std::sin(offsetCycles * juce::MathConstants<float>::twoPi);
+}
+
+void Lfo::reset() {
+  sinValue = 0.0f;
+  cosValue = 1.0f;
+  value = sinValue;
+  offsetValue = sinValue * offsetCos + cosValue * offsetSin;
+  step = offsetStep = 0.0f;
+  samplesUntilUpdate = 0;
+}
+
+void Lfo::advance(int numSamples) {
+  while (numSamples > 0) {
+    if (samplesUntilUpdate == 0)
+      updateControlPoint();
+
+    const int n = std::min(numSamples, samplesUntilUpdate);
+    value += step * static_cast<float>(n);
+    offsetValue += offsetStep * static_cast<float>(n);
+    samplesUntilUpdate -= n;
+    numSamples -= n;
+  }
+}
+
+void Lfo::updateRotation() {
+  const double angle =
+      juce::MathConstants<double>::twoPi * frequencyHz * controlInterval / sampleRate;
+  rotationCos = static_cast<float>(std::cos(angle));
+  rotationSin = static_cast<float>(std::sin(angle));
+}
+
+void Lfo::updateControlPoint() {
+  float newSin = sinValue * rotationCos + cosValue * rotationSin;
+  float newCos = cosValue * rotationCos - sinValue * rotationSin;
+
+  // One Newton step towards unit amplitude keeps the recursion from drifting
+  float gain = 1.5f - 0.5f * (newSin * newSin + newCos * newCos);
+  sinValue = newSin * gain;
+  cosValue = newCos * gain;
+
+  constexpr float invInterval = 1.0f / static_cast<float>(controlInterval);
+  step = (sinValue - value) * invInterval;
+  offsetStep = (sinValue * offsetCos + cosValue * offsetSin - offsetValue) * invInterval;
+  samplesUntilUpdate = controlInterval;
+}
@@ -0,0 +1,70 @@
+#include "meter.h"
+#include <algorithm>
+#include <cmath>
+
+void Meter::prepare(double sampleRate) {
+  frameSamples = std::max(1, static_cast<int>(sampleRate / framesPerSecond));
+  samplesInFrame = 0;
+  numFrameChannels = 0;
+  peak.fill(0.0f);
+  sumOfSquares.fill(0.0f);
+}
+
+template <typename Sample>
+void Meter::process(const Sample* const* channels,
+                    int numChannels,
+                    int numSamples,
+                    const Delay& delay) {
+  numChannels = std::min(numChannels, maxChannels);
+
+  for (int start = 0; start < numSamples;) {
+    const int run = std::min(numSamples - start, frameSamples - samplesInFrame);
+    numFrameChannels = std::max(numFrameChannels, numChannels);
+
+    for (int c = 0; c < numChannels; ++c) {
+      const Sample* samples = channels[c] + start;
+      const auto range = juce::FloatVectorOperations::findMinAndMax(samples, run);
+      peak[c] = std::max(
+          {peak[c], static_cast<float>(-range.getStart()), static_cast<float>(range.getEnd())});
+
+      float sum = 0.0f;
+      for (int i = 0; i < run; ++i)
+        sum += static_cast<float>(samples[i] * samples[i]);
+      sumOfSquares[c] += sum;
+    }
+
+    start += run;
+    samplesInFrame += run;
+    if (samplesInFrame == frameSamples)
+      push(delay);
+  }
+}
+
+template void Meter::process(const float* const*, int, int, const Delay&);
+template void Meter::process(const double* const*, int, int, const Delay&);
+
+void Meter::push(const Delay& delay) {
+  // One frame at most, written in place; a full FIFO drops it
+  auto scope = fifo.write(1);
+  scope.forEach([&](int index) {
+    auto& frame = queue[static_cast<size_t>(index)];
+    frame.numChannels = numFrameChannels;
+    for (int c = 0; c < maxChannels; ++c) {
+      frame.peak[c] = peak[c];
+      frame.rms[c] = std::sqrt(sumOfSquares[c] / static_cast<float>(samplesInFrame));
+    }
+    delay.getRepeatLevels(frame.repeatLevels.data(), numRepeats, frameSamples);
+  });
+
+  samplesInFrame = 0;
+  numFrameChannels = 0;
+  peak.fill(0.0f);
+  sumOfSquares.fill(0.0f);
+}
+
+int Meter::pop(Frame* frames, int maxFrames) {
+  int numPopped = 0;
+  auto scope = fifo.read(std::min(maxFrames, fifo.getNumReady()));
+  scope.forEach([&](int index) { frames[numPopped++] = queue[static_cast<size_t>(index)]; });
+  return numPopped;
+}
@@ -12,49 +12,97 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor(AudioPluginAudi
    * - This Web UI is rendered inside the plugin editor using JUCE's WebBrowserComponent.
    * - Communication between the C++ backend and the WebView is handled via native integration.
    */
-  webView = std::make_unique<juce::WebBrowserComponent>(
-      juce::WebBrowserComponent::Options{}
-          .withNativeIntegrationEnabled()  // (C++ <=> JS bridge, events, etc.)
-
-          // Explicitly use WebView2 backend on Windows for modern HTML/CSS/JS support
-          // JUCE defaults to WebKit on macOS/Linux
-          .withBackend(juce::WebBrowserComponent::Options::Backend::webview2)
-          .withWinWebView2Options(
-              juce::WebBrowserComponent::Options::WinWebView2{}.withUserDataFolder(
-                  juce::File::getSpecialLocation(juce::File::tempDirectory)))
-
-          // Provide WebView UI resources from JUCE BinaryData (HTML/CSS/JS, etc.)
-          .withResourceProvider([this](const auto& url) { return getResource(url); },
-                                juce::URL{"http://localhost:5173/"}.getOrigin())
-
-          // Add support for control focus tracking in the WebView (parameter automation)
-          .withOptionsFrom(controlParameterIndexReceiver)
-
-          // Bind parameter relays for two-way communication (C++ <=> JS)
-          .withOptionsFrom(hiCutFreqRelay)
-          .withOptionsFrom(delayTimeRelay)
-          .withOptionsFrom(feedbackRelay)
-          .withOptionsFrom(wetRelay)
-          .withOptionsFrom(dryRelay)
-          .withOptionsFrom(modDepthRelay)
-          .withOptionsFrom(modRateRelay)
-          .withOptionsFrom(sync)
-          .withOptionsFrom(divisionRelay)
-          .withOptionsFrom(modeRelay)
-
-          // Example: register a JUCE C++ function callable from JS for debugging/testing
-          .withNativeFunction(
-              "exampleNativeFunction",
-              [](const juce::Array<juce::var>& args,
+  auto addSlider = [this](const juce::String& id) {
+    auto& relay = *sliderRelays.emplace_back(std::make_unique<juce::WebSliderRelay>(id));
+    sliderAttachments.push_back(std::make_unique<juce::WebSliderParameterAttachment>(
+        *processorRef.parameters.getParameter(id), relay, nullptr));
+  };
+  auto addComboBox = [this](const juce::String& id) {
+    auto& relay = *comboBoxRelays.emplace_back(std::make_unique<juce::WebComboBoxRelay>(id));
+    comboBoxAttachments.push_back(std::make_unique<juce::WebComboBoxParameterAttachment>(
+        *processorRef.parameters.getParameter(id), relay, nullptr));
+  };
+
+  for (int c = 1; c <= Delay::maxChannels; ++c)
+    addSlider("channelOffset" + juce::String(c));
+  addSlider("taps");
+  for (int t = 1; t <= Delay::maxTaps; ++t) {
+    addSlider("tapTime" + juce::String(t));
+    addComboBox("tapDivision" + juce::String(t));
+    addSlider("tapLevel" + juce::String(t));
+    addSlider("tapPan" + juce::String(t));
+  }
+
+  auto options = juce::WebBrowserComponent::Options{}
+      .withNativeIntegrationEnabled()  // (C++ <=> JS bridge, events, etc.)
+
+      // Explicitly use WebView2 backend on Windows for modern HTML/CSS/JS support
+      // JUCE defaults to WebKit on macOS/Linux
+      .withBackend(juce::WebBrowserComponent::Options::Backend::webview2)
+      .withWinWebView2Options(
+          juce::WebBrowserComponent::Options::WinWebView2{}.withUserDataFolder(
+              juce::File::getSpecialLocation(juce::File::tempDirectory)))
+
+      // Provide WebView UI resources from JUCE BinaryData (HTML/CSS/JS, etc.)
+      .withResourceProvider([this](const auto& url) { return getResource(url); },
+                            juce::URL{"http://localhost:5173/"}.getOrigin())
+
+      // Add support for control focus tracking in the WebView (parameter automation)
+      .withOptionsFrom(controlParameterIndexReceiver)
+
+      // Bind parameter relays for two-way communication (C++ <=> JS)
+      .withOptionsFrom(hiCutFreqRelay)
+      .withOptionsFrom(hiCutSlopeRelay)
+      .withOptionsFrom(lowCutFreqRelay)
+      .withOptionsFrom(delayTimeRelay)
+      .withOptionsFrom(feedbackRelay)
+      .withOptionsFrom(wetRelay)
+      .withOptionsFrom(dryRelay)
+      .withOptionsFrom(modDepthRelay)
+      .withOptionsFrom(modRateRelay)
+      .withOptionsFrom(modWidthRelay)
+      .withOptionsFrom(sync)
+      .withOptionsFrom(divisionRelay)
+      .withOptionsFrom(modeRelay)
+      .withOptionsFrom(timeModeRelay)
+      .withOptionsFrom(timeChangeTimeRelay)
+      .withOptionsFrom(interpolationRelay)
+      .withOptionsFrom(maxDelayRelay)
+      .withOptionsFrom(storageRelay)
+      .withOptionsFrom(channelLinkRelay)
+      .withOptionsFrom(channelSpreadRelay)
+
+      // Example: register a JUCE C++ function callable from JS for debugging/testing
+      .withNativeFunction(
+          "exampleNativeFunction",
+          [](const juce::Array<juce::var>& args,
+             juce::WebBrowserComponent::NativeFunctionCompletion completion) {
+            juce::Logger::writeToLog("exampleNativeFunction called from WebView");
+            for (int i = 0; i < args.size(); ++i)
+              juce::Logger::writeToLog("Arg " + juce::String(i) + ": " + args[i].toString());
+            completion("Hello from JUCE native function!");
+          })
+
+#if DSP_LOAD
+      // processBlock timing (see dsp_load.h), polled by the UI
+      .withNativeFunction(
+          "getDspLoad",
+          [this](const juce::Array<juce::var>& args,
                  juce::WebBrowserComponent::NativeFunctionCompletion completion) {
-                juce::Logger::writeToLog("exampleNativeFunction called from WebView");
-                for (int i = 0; i < args.size(); ++i)
-                  juce::Logger::writeToLog("Arg " + juce::String(i) + ": " + args[i].toString());
-                completion("Hello from JUCE native function!");
-              })
+            juce::ignoreUnused(args);
+            completion(processorRef.getDspLoad().getStats().toVar());
+          })
+#endif
+
+      // Inject debug message into browser console on load
+      .withUserScript(R"(console.log("JUCE C++ Backend is running!");)");
 
-          // Inject debug message into browser console on load
-          .withUserScript(R"(console.log("JUCE C++ Backend is running!");)"));
+  for (auto& relay : sliderRelays)
+    options = options.withOptionsFrom(*relay);
+  for (auto& relay : comboBoxRelays)
+    options = options.withOptionsFrom(*relay);
+
+  webView = std::make_unique<juce::WebBrowserComponent>(options);
 
   // Ensure WebView is added after full construction (avoids timing issues)
   juce::MessageManager::callAsync([this]() {
@@ -66,6 +114,8 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor(AudioPluginAudi
   // Set size of desktop plugin window (pixels)
   setSize(430, 830);
 
+  startTimerHz(static_cast<int>(Meter::framesPerSecond));
+
   /**
    * Initialize Native JUCE UI (for development and demo purposes)
    */
@@ -159,16 +209,45 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor(AudioPluginAudi
   // modeBox.addItem("Mono", 1);
   // modeBox.addItem("Stereo", 2);
   // modeBox.addItem("PingPong", 3);
+  // modeBox.addItem("Diffuse", 4);
   // modeAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(
   //     processorRef.getParameters(), "mode", modeBox);
 }
 
 AudioPluginAudioProcessorEditor::~AudioPluginAudioProcessorEditor() {
+  stopTimer();
   webView->setVisible(false);
   webView->stop();
   juce::Logger::writeToLog("~AudioPluginAudioProcessorEditor destroyed");
 }
 
+void AudioPluginAudioProcessorEditor::timerCallback() {
+  const int numFrames =
+      processorRef.getMeter().pop(meterFrames.data(), static_cast<int>(meterFrames.size()));
+  if (numFrames == 0)
+    return;
+
+  const auto toArray = [](const float* values, int count) {
+    juce::Array<juce::var> array;
+    for (int i = 0; i < count; ++i)
+      array.add(values[i]);
+    return array;
+  };
+
+  // [{ peak: [per channel], rms: [per channel], repeats: [per repeat] }, ...], oldest first
+  juce::Array<juce::var> frames;
+  for (int f = 0; f < numFrames; ++f) {
+    const auto& frame = meterFrames[static_cast<size_t>(f)];
+    auto* object = new juce::DynamicObject();
+    object->setProperty("peak", toArray(frame.peak.data(), frame.numChannels));
+    object->setProperty("rms", toArray(frame.rms.data(), frame.numChannels));
+    object->setProperty("repeats", toArray(frame.repeatLevels.data(), Meter::numRepeats));
+    frames.add(juce::var(object));
+  }
+
+  webView->emitEventIfBrowserIsVisible("meters", juce::var(frames));
+}
+
 void AudioPluginAudioProcessorEditor::paint(juce::Graphics& g) {
   // g.fillAll(getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId));
   // g.setColour(juce::Colours::white);
@@ -5,6 +5,38 @@
 #endif
 
 namespace audio_plugin {
+namespace {
+// Choices of the "maxDelay" parameter, in seconds
+constexpr std::array<double, 5> maxDelayTimes = {2.0, 5.0, 10.0, 20.0, 30.0};
+
+// Choices of the "division" and "tapDivision" parameters, in whole notes
+constexpr std::array<float, 6> noteDurations = {1.0f, 0.5f, 0.25f, 0.125f, 0.1875f, 0.0625f};
+
+#if DSP_LOAD && HEADLESS
+// How often headless builds write the DSP load to the log
+constexpr int dspLoadLogIntervalMs = 10000;
+#endif
+
+#if CONTROL_SOCKET
+// Instances on one device after the first find their socket by number
+constexpr int maxControlSockets = 16;
+
+// Where the control socket of the instance numbered `instance` listens: /tmp/delay-control.sock
+// (or the path in DELAY_CONTROL_SOCKET) for the first, with "-<instance>" before the
+// extension for the others
+juce::String getInstanceSocketPath(int instance) {
+  auto path = juce::SystemStats::getEnvironmentVariable("DELAY_CONTROL_SOCKET", {});
+  if (path.isEmpty())
+    path = "/tmp/delay-control.sock";
+  if (instance == 0)
+    return path;
+
+  const auto suffix = "-" + juce::String(instance);
+  return path.endsWith(".sock") ? path.dropLastCharacters(5) + suffix + ".sock" : path + suffix;
+}
+#endif
+}  // namespace
+
 AudioPluginAudioProcessor::AudioPluginAudioProcessor()
     : AudioProcessor(BusesProperties()
 #if !JucePlugin_IsMidiEffect
@@ -18,31 +50,115 @@ AudioPluginAudioProcessor::AudioPluginAudioProcessor()
         using namespace juce;
         std::vector<std::unique_ptr<RangedAudioParameter>> params;
 
-        params.push_back(
-            std::make_unique<AudioParameterFloat>("delayTime", "delayTime", 0.01f, 2.0f, 0.33f));
+        NormalisableRange<float> delayTimeRange(0.01f, static_cast<float>(Delay::maxDelayLimit));
+        delayTimeRange.setSkewForCentre(1.0f);
+        const StringArray divisions{"1/1", "1/2", "1/4", "1/8", "1/8 Dotted", "1/16"};
+        params.push_back(std::make_unique<AudioParameterFloat>("delayTime", "delayTime",
+                                                               delayTimeRange, 0.33f));
+        params.push_back(std::make_unique<AudioParameterChoice>(
+            "maxDelay", "maxDelay", StringArray{"2 s", "5 s", "10 s", "20 s", "30 s"}, 0));
+        params.push_back(std::make_unique<AudioParameterChoice>(
+            "storage", "storage", StringArray{"Float", "Half", "16-bit"}, 0));
         params.push_back(
             std::make_unique<AudioParameterFloat>("feedback", "feedback", 0.0f, 0.99f, 0.26f));
         params.push_back(std::make_unique<AudioParameterFloat>("wetLevel", "wetLevel", 0.0f, 1.0f, 0.11f));
         params.push_back(std::make_unique<AudioParameterFloat>("dryLevel", "dryLevel", 0.0f, 1.0f, 1.0f));
         params.push_back(std::make_unique<AudioParameterFloat>("hiCutFreq", "hiCutFreq",
                                                                500.0f, 16000.0f, 9800.0f));
+        params.push_back(std::make_unique<AudioParameterChoice>(
+            "hiCutSlope", "hiCutSlope", StringArray{"12 dB/oct", "24 dB/oct", "48 dB/oct"}, 0));
+        // The low-cut is off at the bottom of its range
+        NormalisableRange<float> lowCutRange(20.0f, 2000.0f);
+        lowCutRange.setSkewForCentre(200.0f);
+        params.push_back(
+            std::make_unique<AudioParameterFloat>("lowCutFreq", "lowCutFreq", lowCutRange, 20.0f));
         params.push_back(
             std::make_unique<AudioParameterFloat>("modDepth", "modDepth", 0.0f, 0.4f, 0.2f));
         params.push_back(
             std::make_unique<AudioParameterFloat>("modRate", "modRate", 0.01f, 4.0f, 2.0f));
+        params.push_back(
+            std::make_unique<AudioParameterFloat>("modWidth", "modWidth", 0.0f, 0.5f, 0.0f));
         params.push_back(std::make_unique<AudioParameterBool>("sync", "sync", false));
-        params.push_back(std::make_unique<juce::AudioParameterChoice>(
-            "division", "division",
-            juce::StringArray{"1/1", "1/2", "1/4", "1/8", "1/8 Dotted", "1/16"}, 0));
+        params.push_back(
+            std::make_unique<juce::AudioParameterChoice>("division", "division", divisions, 0));
+        params.push_back(std::make_unique<AudioParameterChoice>(
+            "mode", "mode", StringArray{"Mono", "Stereo", "PingPong", "Diffuse"}, 1));
         params.push_back(std::make_unique<AudioParameterChoice>(
-            "mode", "mode", StringArray{"Mono", "Stereo", "PingPong"}, 1));
+            "timeMode", "timeMode", StringArray{"Crossfade", "Glide"}, 0));
+        params.push_back(std::make_unique<AudioParameterFloat>("timeChangeTime", "timeChangeTime",
+                                                               0.0f, 1.0f, 0.1f));
+        params.push_back(std::make_unique<AudioParameterChoice>(
+            "interpolation", "interpolation",
+            StringArray{"None", "Linear", "Hermite", "Lagrange", "Allpass"}, 1));
+
+        // Per-channel time offsets for layouts wider than stereo
+        params.push_back(std::make_unique<AudioParameterBool>("channelLink", "channelLink", true));
+        params.push_back(std::make_unique<AudioParameterFloat>("channelSpread", "channelSpread",
+                                                               0.0f, 0.5f, 0.0f));
+        for (int c = 1; c <= Delay::maxChannels; ++c) {
+          const auto id = "channelOffset" + String(c);
+          params.push_back(std::make_unique<AudioParameterFloat>(id, id, 0.0f, 1.0f, 0.0f));
+        }
+
+        // Multi-tap: "taps" extra reads of the line (0 = off), each with its own settings
+        params.push_back(
+            std::make_unique<AudioParameterInt>("taps", "taps", 0, Delay::maxTaps, 0));
+        for (int t = 1; t <= Delay::maxTaps; ++t) {
+          const auto n = String(t);
+          params.push_back(std::make_unique<AudioParameterFloat>(
+              "tapTime" + n, "tapTime" + n, delayTimeRange, 0.125f * static_cast<float>(t)));
+          params.push_back(std::make_unique<AudioParameterChoice>("tapDivision" + n,
+                                                                  "tapDivision" + n, divisions, 3));
+          params.push_back(std::make_unique<AudioParameterFloat>("tapLevel" + n, "tapLevel" + n,
+                                                                 0.0f, 1.0f, 0.5f));
+          params.push_back(std::make_unique<AudioParameterFloat>("tapPan" + n, "tapPan" + n,
+                                                                 -1.0f, 1.0f, 0.0f));
+        }
 
         return juce::AudioProcessorValueTreeState::ParameterLayout{params.begin(), params.end()};
       }()) {
+  for (size_t i = 0; i < rawParameters.size(); ++i) {
+    rawParameters[i] = parameters.getRawParameterValue(getParameterId(i));
+    jassert(rawParameters[i] != nullptr);
+  }
+
+  presets.push_back({"Default", parameters.copyState()});
+
+  startTimerHz(10);
+
+#if DSP_LOAD && HEADLESS
+  dspLoadLogger = std::make_unique<DspLoadLogger>(dspLoad, dspLoadLogIntervalMs);
+#endif
+
+#if CONTROL_SOCKET
+  std::vector<ControlServer::Parameter> controls;
+  for (size_t i = 0; i < rawParameters.size(); ++i) {
+    const auto id = getParameterId(i);
+    controls.push_back({id, parameters.getParameterRange(id)});
+  }
+  // The first path no live instance answers on, whether in this process or another one
+  for (int instance = 0; instance < maxControlSockets; ++instance) {
+    controlServer = std::make_unique<ControlServer>(getInstanceSocketPath(instance), controls,
+                                                    [this] { return getTelemetry(); });
+    if (controlServer->isListening())
+      break;
+  }
+  controlServer->setNumPresets(getNumPresets());
+#endif
 }
 
 AudioPluginAudioProcessor::~AudioPluginAudioProcessor() {
+  stopTimer();
+#if CONTROL_SOCKET
+  controlServer.reset();
+#endif
+#if DSP_LOAD
+  dspLoadLogger.reset();
+#endif
   releaseResources();
+  delete pendingRecall.exchange(nullptr);
+  releaseRetiredRecall();
+  delete activeRecall;
   juce::Logger::writeToLog("[Processor] Destructor called");
 }
 
@@ -60,42 +176,133 @@ bool AudioPluginAudioProcessor::isMidiEffect() const {
   return false;
 }
 double AudioPluginAudioProcessor::getTailLengthSeconds() const {
-  return 2.0;
+  return tailSeconds.load(std::memory_order_relaxed);
 }
 
 int AudioPluginAudioProcessor::getNumPrograms() {
-  return 1;
+  return getNumPresets();
 }
 int AudioPluginAudioProcessor::getCurrentProgram() {
-  return 0;
+  return currentPreset;
 }
 void AudioPluginAudioProcessor::setCurrentProgram(int index) {
-  juce::ignoreUnused(index);
+  recallPreset(index);
 }
 const juce::String AudioPluginAudioProcessor::getProgramName(int index) {
-  juce::ignoreUnused(index);
-  return {};
+  return getPresetName(index);
 }
 void AudioPluginAudioProcessor::changeProgramName(int index, const juce::String& newName) {
-  juce::ignoreUnused(index, newName);
+  if (juce::isPositiveAndBelow(index, getNumPresets()) && newName.isNotEmpty())
+    presets[static_cast<size_t>(index)].name = newName;
+}
+
+juce::String AudioPluginAudioProcessor::getParameterId(size_t index) {
+  static constexpr std::array<const char*, channelOffsetIndex> ids = {
+      "delayTime",     "feedback",       "wetLevel",      "dryLevel",    "hiCutFreq",
+      "hiCutSlope",    "lowCutFreq",     "modDepth",      "modRate",     "modWidth",
+      "sync",          "division",       "mode",          "timeMode",    "timeChangeTime",
+      "interpolation", "maxDelay",       "storage",       "channelLink", "channelSpread"};
+
+  if (index < ids.size())
+    return ids[index];
+  if (index < tapCountIndex)
+    return "channelOffset" + juce::String(index - channelOffsetIndex + 1);
+  if (index == tapCountIndex)
+    return "taps";
+
+  static constexpr std::array<const char*, 4> tapIds = {"tapTime", "tapDivision", "tapLevel",
+                                                        "tapPan"};
+  const size_t tapIndex = index - tapTimeIndex;
+  return tapIds[tapIndex / Delay::maxTaps] + juce::String(tapIndex % Delay::maxTaps + 1);
 }
 
 void AudioPluginAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBlock) {
   juce::ignoreUnused(samplesPerBlock);
 
+  delay.setNumChannels(getTotalNumOutputChannels());
+  requestedMaxDelayTime = getMaxDelayTimeSetting();
+  delay.setMaxDelayTime(requestedMaxDelayTime);
+  requestedStorageFormat = getStorageFormatSetting();
+  delay.setStorageFormat(requestedStorageFormat);
+  requestedNetworkLayout = getNetworkLayoutSetting();
+  delay.setNetworkLayout(requestedNetworkLayout);
   delay.setSampleRate(sampleRate);
+  applyParameters();
+  meter.prepare(sampleRate);
+
+#if DSP_LOAD
+  dspLoad.prepare(sampleRate);
+#endif
 
   // Ignore build warnings for unused variables
   juce::ignoreUnused(sampleRate, samplesPerBlock);
 }
 
+double AudioPluginAudioProcessor::getMaxDelayTimeSetting() const {
+  const auto index = static_cast<size_t>(rawParameters[maxDelayIndex]->load());
+  return maxDelayTimes[std::min(index, maxDelayTimes.size() - 1)];
+}
+
+Delay::StorageFormat AudioPluginAudioProcessor::getStorageFormatSetting() const {
+  switch (static_cast<int>(rawParameters[storageIndex]->load())) {
+    case 1:
+      return Delay::StorageFormat::Float16;
+    case 2:
+      return Delay::StorageFormat::Int16;
+    default:
+      // Full precision, whichever the host processes in
+      return isUsingDoublePrecision() ? Delay::StorageFormat::Float64
+                                      : Delay::StorageFormat::Float32;
+  }
+}
+
+bool AudioPluginAudioProcessor::getNetworkLayoutSetting() const {
+  const auto mode =
+      static_cast<Delay::DelayMode>(static_cast<int>(rawParameters[modeIndex]->load()));
+  return mode == Delay::DelayMode::Diffuse;
+}
+
+void AudioPluginAudioProcessor::timerCallback() {
+  // A line with a new maximum delay, storage format or layout is allocated here, off the
+  // audio thread; processBlock swaps it in
+  delay.releaseRetiredDelayLine();
+  releaseRetiredRecall();
+
+  const double maxDelayTime = getMaxDelayTimeSetting();
+  const auto storageFormat = getStorageFormatSetting();
+  const bool networkLayout = getNetworkLayoutSetting();
+  if (maxDelayTime != requestedMaxDelayTime || storageFormat != requestedStorageFormat ||
+      networkLayout != requestedNetworkLayout) {
+    requestedMaxDelayTime = maxDelayTime;
+    requestedStorageFormat = storageFormat;
+    requestedNetworkLayout = networkLayout;
+    // The settings travel with the line; the Delay itself belongs to the audio thread
+    delay.submitDelayLine(delay.createDelayLine(maxDelayTime, storageFormat, networkLayout));
+  }
+
+#if CONTROL_SOCKET
+  // The audio thread already uses what was set over the control socket; hosts and the saved
+  // state follow from here
+  if (const int preset = controlServer->takePresetRequest(); preset >= 0)
+    recallPreset(preset);
+  controlServer->forEachParameterChange([this](size_t index, float value) {
+    auto* param = parameters.getParameter(getParameterId(index));
+    param->setValueNotifyingHost(param->convertTo0to1(value));
+  });
+#endif
+}
+
 void AudioPluginAudioProcessor::releaseResources() {
   juce::Logger::writeToLog("[Processor] releaseResources() called");
+#if DSP_LOAD
+  juce::Logger::writeToLog("[DSP load] " + dspLoad.getStats().toString());
+#endif
 }
 
 bool AudioPluginAudioProcessor::isBusesLayoutSupported(const BusesLayout& layouts) const {
-  if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono() &&
-      layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+  // Mono, stereo, or up to Delay::maxChannels channels treated as discrete
+  const int numChannels = layouts.getMainOutputChannelSet().size();
+  if (numChannels < 1 || numChannels > Delay::maxChannels)
     return false;
 
 #if !JucePlugin_IsSynth
@@ -106,45 +313,202 @@ bool AudioPluginAudioProcessor::isBusesLayoutSupported(const BusesLayout& layout
   return true;
 }
 
+void AudioPluginAudioProcessor::applyParameters() {
+  // The order matters: a recall publishes its values before it moves any parameter, and
+  // settles after moving them all. So if the live values below include a recalled one, the
+  // recall is pending by the time it is checked, and once settled they include all of them.
+  const uint32_t settled = settledGeneration.load();
+  ParameterValues live;
+  for (size_t i = 0; i < live.size(); ++i)
+    live[i] = rawParameters[i]->load();
+  const bool recalled = adoptPendingRecall();
+#if CONTROL_SOCKET
+  // A recall replaces whatever was set over the socket before it, even where it leaves the
+  // parameter where the set found it
+  if (recalled)
+    controlled.fill(false);
+  applyControlChanges(live);
+#else
+  juce::ignoreUnused(recalled);
+#endif
+
+  const bool recalling = activeRecall != nullptr && activeRecall->generation != settled;
+  const ParameterValues& values = recalling ? activeRecall->values : live;
+
+  Delay::Parameters p;
+  p.delayTimeSeconds = values[delayTimeIndex];
+  p.feedback = values[feedbackIndex];
+  p.wetLevel = values[wetLevelIndex];
+  p.dryLevel = values[dryLevelIndex];
+  p.hiCutFreq = values[hiCutFreqIndex];
+  p.hiCutSlope = static_cast<FeedbackFilter::Slope>(static_cast<int>(values[hiCutSlopeIndex]));
+  p.lowCutFreq = values[lowCutFreqIndex];
+  p.modulationDepthSeconds = values[modDepthIndex];
+  p.modulationRateHz = values[modRateIndex];
+  p.modulationPhaseOffset = values[modWidthIndex];
+  p.syncToTempo = values[syncIndex] > 0.5f;
+
+  auto getNoteDuration = [](float choice) {
+    return noteDurations[std::min(static_cast<size_t>(choice), noteDurations.size() - 1)];
+  };
+  p.noteDivision = getNoteDuration(values[divisionIndex]);
+
+  p.hostBpm = 120.0f;
+  if (auto* playHead = getPlayHead())
+    if (auto position = playHead->getPosition())
+      p.hostBpm = static_cast<float>(position->getBpm().orFallback(120.0));
+  p.mode = static_cast<Delay::DelayMode>(static_cast<int>(values[modeIndex]));
+  p.timeChange = static_cast<Delay::TimeChange>(static_cast<int>(values[timeModeIndex]));
+  p.timeChangeSeconds = values[timeChangeTimeIndex];
+  p.interpolation =
+      static_cast<Delay::Interpolation>(static_cast<int>(values[interpolationIndex]));
+  p.linkChannelOffsets = values[channelLinkIndex] > 0.5f;
+  p.channelSpreadSeconds = values[channelSpreadIndex];
+  for (size_t c = 0; c < p.channelOffsetSeconds.size(); ++c)
+    p.channelOffsetSeconds[c] = values[channelOffsetIndex + c];
+
+  p.numTaps = static_cast<int>(values[tapCountIndex]);
+  for (size_t t = 0; t < p.taps.size(); ++t) {
+    auto& tap = p.taps[t];
+    tap.delayTimeSeconds = values[tapTimeIndex + t];
+    tap.noteDivision = getNoteDuration(values[tapDivisionIndex + t]);
+    tap.level = values[tapLevelIndex + t];
+    tap.pan = values[tapPanIndex + t];
+  }
+
+  delay.setParameters(p);
+
+  // Hosts stop calling processBlock this long after the input ends
+  tailSeconds.store(std::min(delay.getTailSeconds(), maxTailSeconds), std::memory_order_relaxed);
+}
+
+#if CONTROL_SOCKET
+void AudioPluginAudioProcessor::applyControlChanges(ParameterValues& values) {
+  // Bounded, whole batches only; the rest waits for the next block
+  controlServer->drainChanges(ControlServer::maxChangesPerBlock, [&](size_t index, float value) {
+    if (!controlled[index]) {
+      controlled[index] = true;
+      controlledFrom[index] = values[index];
+    }
+    controlValues[index] = value;
+  });
+
+  for (size_t i = 0; i < values.size(); ++i) {
+    if (!controlled[i])
+      continue;
+    if (values[i] != controlledFrom[i])
+      controlled[i] = false;
+    else
+      values[i] = controlValues[i];
+  }
+}
+
+juce::var AudioPluginAudioProcessor::getTelemetry() {
+  auto* object = new juce::DynamicObject();
+
+  auto* values = new juce::DynamicObject();
+  for (size_t i = 0; i < rawParameters.size(); ++i)
+    values->setProperty(getParameterId(i), rawParameters[i]->load());
+  object->setProperty("parameters", juce::var(values));
+  object->setProperty("socket", controlServer->getPath());
+  object->setProperty("tailSeconds", getTailLengthSeconds());
+
+#if HEADLESS
+  // Without an editor this thread is the meter's only reader
+  std::array<Meter::Frame, Meter::capacity> frames;
+  if (const int numFrames = meter.pop(frames.data(), static_cast<int>(frames.size())))
+    lastMeterFrame = frames[static_cast<size_t>(numFrames - 1)];
+
+  auto toArray = [](const float* levels, int numLevels) {
+    juce::Array<juce::var> array;
+    for (int i = 0; i < numLevels; ++i)
+      array.add(levels[i]);
+    return juce::var(array);
+  };
+  auto* meters = new juce::DynamicObject();
+  meters->setProperty("peak", toArray(lastMeterFrame.peak.data(), lastMeterFrame.numChannels));
+  meters->setProperty("rms", toArray(lastMeterFrame.rms.data(), lastMeterFrame.numChannels));
+  meters->setProperty("repeats",
+                      toArray(lastMeterFrame.repeatLevels.data(), Meter::numRepeats));
+  object->setProperty("meters", juce::var(meters));
+#endif
+
+#if DSP_LOAD
+  object->setProperty("dspLoad", dspLoad.getStats().toVar());
+#endif
+
+  return juce::var(object);
+}
+#endif
+
+bool AudioPluginAudioProcessor::adoptPendingRecall() {
+  // As Delay::adoptPendingDelayLine: nothing is freed here, and a new recall is only taken
+  // once the one it replaces can be handed back. Between two releases this happens at most
+  // twice (see recallState), so there is always a free slot.
+  if (pendingRecall.load(std::memory_order_relaxed) == nullptr)
+    return false;
+
+  auto slot = std::find_if(retiredRecalls.begin(), retiredRecalls.end(), [](const auto& retired) {
+    return retired.load(std::memory_order_acquire) == nullptr;
+  });
+  if (slot == retiredRecalls.end())
+    return false;
+
+  Recall* next = pendingRecall.exchange(nullptr, std::memory_order_acq_rel);
+  if (next == nullptr)
+    return false;
+
+  slot->store(activeRecall, std::memory_order_release);
+  activeRecall = next;
+  return true;
+}
+
+void AudioPluginAudioProcessor::releaseRetiredRecall() {
+  for (auto& retired : retiredRecalls)
+    delete retired.exchange(nullptr);
+}
+
 void AudioPluginAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer,
                                              juce::MidiBuffer& midiMessages) {
   juce::ignoreUnused(midiMessages);
-  juce::ScopedNoDenormals noDenormals;
+  processSamples(buffer);
+}
 
-  Delay::Parameters p;
-  p.delayTimeSeconds = *parameters.getRawParameterValue("delayTime");
-  p.feedback = *parameters.getRawParameterValue("feedback");
-  p.wetLevel = *parameters.getRawParameterValue("wetLevel");
-  p.dryLevel = *parameters.getRawParameterValue("dryLevel");
-  p.hiCutFreq = *parameters.getRawParameterValue("hiCutFreq");
-  p.modulationDepthSeconds = *parameters.getRawParameterValue("modDepth");
-  p.modulationRateHz = *parameters.getRawParameterValue("modRate");
-  p.syncToTempo = *parameters.getRawParameterValue("sync") > 0.5f;
-
-  static const std::array<float, 6> noteDurations = {1.0f, 0.5f, 0.25f, 0.125f, 0.1875f, 0.0625f};
-  int divisionIndex = static_cast<int>(*parameters.getRawParameterValue("division"));
-  p.noteDivision = noteDurations[divisionIndex];
-
-  p.hostBpm = getPlayHead()->getPosition()->getBpm().orFallback(120.0);
-  p.mode =
-      static_cast<Delay::DelayMode>(static_cast<int>(*parameters.getRawParameterValue("mode")));
+void AudioPluginAudioProcessor::processBlock(juce::AudioBuffer<double>& buffer,
+                                             juce::MidiBuffer& midiMessages) {
+  juce::ignoreUnused(midiMessages);
+  processSamples(buffer);
+}
 
-  delay.setParameters(p);
+template <typename Sample>
+void AudioPluginAudioProcessor::processSamples(juce::AudioBuffer<Sample>& buffer) {
+  juce::ScopedNoDenormals noDenormals;
+#if DSP_LOAD
+  DspLoad::ScopedMeasurement measurement(dspLoad, buffer.getNumSamples());
+#endif
+
+  applyParameters();
 
   auto* left = buffer.getWritePointer(0);
   auto* right = buffer.getNumChannels() > 1 ? buffer.getWritePointer(1) : nullptr;
 
-  if ((buffer.getNumChannels() == 1 || right == nullptr) && getTotalNumOutputChannels() == 1) {
+  if (getTotalNumOutputChannels() > 2) {
+    // Discrete multichannel
+    delay.processMultichannel(buffer.getArrayOfWritePointers(), buffer.getNumSamples());
+  } else if ((buffer.getNumChannels() == 1 || right == nullptr) && getTotalNumOutputChannels() == 1) {
     // Mono to Mono
     delay.processMono(left, buffer.getNumSamples());
   } else if (buffer.getNumChannels() == 1 && getTotalNumOutputChannels() == 2) {
     // Mono to Stereo
-    std::fill(right, right + buffer.getNumSamples(), 0.0f);  // clear to avoid doubling
+    std::fill(right, right + buffer.getNumSamples(), Sample{});  // clear to avoid doubling
     delay.processStereo(left, right, buffer.getNumSamples());
   } else {
     // Stereo to Stereo
     delay.processStereo(left, right, buffer.getNumSamples());
   }
+
+  meter.process(buffer.getArrayOfReadPointers(), getTotalNumOutputChannels(),
+                buffer.getNumSamples(), delay);
 }
 
 bool AudioPluginAudioProcessor::hasEditor() const {
@@ -159,12 +523,123 @@ juce::AudioProcessorEditor* AudioPluginAudioProcessor::createEditor() {
 #endif
 }
 
+int AudioPluginAudioProcessor::storePreset(const juce::String& name) {
+  for (size_t i = 0; i < presets.size(); ++i) {
+    if (presets[i].name == name) {
+      presets[i].state = parameters.copyState();
+      currentPreset = static_cast<int>(i);
+      return currentPreset;
+    }
+  }
+
+  presets.push_back({name, parameters.copyState()});
+  currentPreset = getNumPresets() - 1;
+#if CONTROL_SOCKET
+  controlServer->setNumPresets(getNumPresets());
+#endif
+  return currentPreset;
+}
+
+bool AudioPluginAudioProcessor::recallPreset(int index) {
+  if (!juce::isPositiveAndBelow(index, getNumPresets()))
+    return false;
+
+  currentPreset = index;
+  recallState(presets[static_cast<size_t>(index)].state);
+  return true;
+}
+
+juce::String AudioPluginAudioProcessor::getPresetName(int index) const {
+  if (!juce::isPositiveAndBelow(index, getNumPresets()))
+    return {};
+  return presets[static_cast<size_t>(index)].name;
+}
+
+AudioPluginAudioProcessor::ParameterValues AudioPluginAudioProcessor::getParameterValues(
+    const juce::ValueTree& state) const {
+  // Parameters missing from the tree go back to their defaults, as in replaceState
+  ParameterValues values;
+  for (size_t i = 0; i < values.size(); ++i) {
+    const auto id = getParameterId(i);
+    const auto* param = parameters.getParameter(id);
+    const float fallback = param->convertFrom0to1(param->getDefaultValue());
+    values[i] =
+        static_cast<float>(state.getChildWithProperty("id", id).getProperty("value", fallback));
+  }
+  return values;
+}
+
+void AudioPluginAudioProcessor::recallState(const juce::ValueTree& state) {
+  auto recall = std::make_unique<Recall>();
+  recall->values = getParameterValues(state);
+  recall->generation = ++recallGeneration;
+
+  // The audio thread has handed back everything but the active recall. Before the swap
+  // below it can still adopt the recall pending until then, and after it this one, which
+  // fills at most both retired slots; so it never has to keep a recall that is out of date.
+  releaseRetiredRecall();
+  delete pendingRecall.exchange(recall.release());
+
+  // Hosts and the editor follow the parameters; until they all match, the audio thread keeps
+  // to the published values
+  parameters.replaceState(state.createCopy());
+  settledGeneration.store(recallGeneration);
+}
+
 void AudioPluginAudioProcessor::getStateInformation(juce::MemoryBlock& destData) {
-  juce::ignoreUnused(destData);
+  // <DelayState version> <PARAMETERS/> <Presets current> <Preset name> <PARAMETERS/> ...
+  juce::ValueTree state("DelayState");
+  state.setProperty("version", stateVersion, nullptr);
+  state.appendChild(parameters.copyState(), nullptr);
+
+  juce::ValueTree bank("Presets");
+  bank.setProperty("current", currentPreset, nullptr);
+  for (const auto& preset : presets) {
+    juce::ValueTree entry("Preset");
+    entry.setProperty("name", preset.name, nullptr);
+    entry.appendChild(preset.state.createCopy(), nullptr);
+    bank.appendChild(entry, nullptr);
+  }
+  state.appendChild(bank, nullptr);
+
+  // Binary rather than XML: about half the size, and no parsing on load
+  juce::MemoryOutputStream stream(destData, false);
+  state.writeToStream(stream);
 }
 
 void AudioPluginAudioProcessor::setStateInformation(const void* data, int sizeInBytes) {
-  juce::ignoreUnused(data, sizeInBytes);
+  const auto state = juce::ValueTree::readFromData(data, static_cast<size_t>(sizeInBytes));
+  if (!state.hasType("DelayState")) {
+    juce::Logger::writeToLog("[Processor] Ignoring unrecognised state");
+    return;
+  }
+
+  // Version 1 is the first; a newer one is read as far as it matches this layout
+  const int version = state.getProperty("version", 0);
+  if (version > stateVersion)
+    juce::Logger::writeToLog("[Processor] Loading state version " + juce::String(version) +
+                             " written by a newer build");
+
+  const auto bank = state.getChildWithName("Presets");
+  if (bank.isValid()) {
+    presets.clear();
+    for (const auto& entry : bank) {
+      const auto preset = entry.getChildWithName(parameters.state.getType());
+      if (entry.hasType("Preset") && preset.isValid())
+        presets.push_back({entry.getProperty("name").toString(), preset.createCopy()});
+    }
+    if (presets.empty())
+      presets.push_back({"Default", parameters.copyState()});
+    currentPreset =
+        juce::jlimit(0, getNumPresets() - 1, static_cast<int>(bank.getProperty("current", 0)));
+#if CONTROL_SOCKET
+    controlServer->setNumPresets(getNumPresets());
+#endif
+  }
+
+  const auto saved = state.getChildWithName(parameters.state.getType());
+  if (saved.isValid())
+    recallState(saved);
 }
 }  // namespace audio_plugin
 
@@ -0,0 +1,67 @@
+#include "read_heads.h"
+#include <cmath>
+
+void ReadHeads::prepare(double newSampleRate) {
+  sampleRate = newSampleRate;
+  setTransitionTime(transitionSeconds);
+  snapTo(target);
+}
+
+void ReadHeads::setTransitionTime(float seconds) {
+  transitionSeconds = seconds;
+  transitionSamples = static_cast<int>(std::lround(seconds * sampleRate));
+}
+
+void ReadHeads::setTarget(float delaySamples) {
+  if (delaySamples == target)
+    return;
+
+  if (transitionSamples <= 0) {
+    snapTo(delaySamples);
+    return;
+  }
+
+  target = delaySamples;
+
+  if (mode == Mode::Glide) {
+    glideStep = (target - delay) / static_cast<float>(transitionSamples);
+    glideSamplesLeft = transitionSamples;
+  } else if (isCrossfading()) {
+    pendingDelay = target;
+    hasPending = true;
+  } else {
+    startCrossfade(target);
+  }
+}
+
+void ReadHeads::snapTo(float delaySamples) {
+  target = delay = previousDelay = delaySamples;
+  glideSamplesLeft = 0;
+  fade = 1.0f;
+  fadeSamplesLeft = 0;
+  hasPending = false;
+}
+
+void ReadHeads::startCrossfade(float delaySamples) {
+  if (transitionSamples <= 0) {
+    snapTo(delaySamples);
+    return;
+  }
+
+  previousDelay = delay;
+  delay = delaySamples;
+  glideSamplesLeft = 0;
+  fade = 0.0f;
+  fadeStep = 1.0f / static_cast<float>(transitionSamples);
+  fadeSamplesLeft = transitionSamples;
+}
+
+void ReadHeads::finishCrossfade() {
+  fade = 1.0f;
+  previousDelay = delay;
+
+  if (hasPending) {
+    hasPending = false;
+    startCrossfade(pendingDelay);
+  }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <juce_core/juce_core.h>
+
+namespace audio_plugin_render {
+// How every file of a batch is rendered
+struct RenderSpec {
+  int blockSize = 512;
+  double tailSeconds = -1.0;  // negative: use the processor's tail length
+
+  // Parameter ID -> value, in plain units (e.g. seconds) or choice text ("PingPong")
+  juce::NamedValueSet parameters;
+};
+
+struct RenderResult {
+  juce::File input;
+  juce::File output;
+  juce::String error;  // empty on success
+
+  double audioSeconds = 0.0;
+  double wallSeconds = 0.0;
+
+  bool ok() const { return error.isEmpty(); }
+  double getRealtimeFactor() const { return wallSeconds > 0.0 ? audioSeconds / wallSeconds : 0.0; }
+};
+
+// Reads a JSON spec: { "blockSize": 512, "tailSeconds": 2.0, "parameters": { ... } }.
+// Returns an error message, or an empty string on success.
+juce::String parseSpec(const juce::var& json, RenderSpec& spec);
+
+// Streams one file through its own AudioPluginAudioProcessor in blockSize chunks. The output
+// has the input's format (chosen by extension), channel count, rate and bit depth.
+RenderResult renderFile(const juce::File& input, const juce::File& output, const RenderSpec& spec);
+
+// Renders every file on its own pool thread; results are in input order
+std::vector<RenderResult> renderFiles(const juce::Array<juce::File>& inputs,
+                                      const juce::File& outputDirectory,
+                                      const RenderSpec& spec,
+                                      int numThreads);
+}  // namespace audio_plugin_render
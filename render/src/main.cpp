@@ -0,0 +1,119 @@
+#include "offline_renderer.h"
+#include <juce_events/juce_events.h>
+#include <iostream>
+
+namespace {
+constexpr const char* usage =
+    "Usage: AudioPluginRender [options] <input.wav|aiff>...\n"
+    "\n"
+    "  --spec <file.json>    blockSize, tailSeconds and a \"parameters\" object\n"
+    "  --set <id>=<value>    set a parameter (overrides the spec), e.g. --set mode=PingPong\n"
+    "  --block-size <n>      samples per processBlock call (default 512)\n"
+    "  --tail <seconds>      silence rendered after each input (default: plugin tail)\n"
+    "  --jobs <n>            files rendered in parallel (default: number of cores)\n"
+    "  --out-dir <dir>       where outputs are written, same file names (default ./rendered)\n";
+
+// Numbers stay numbers, anything else is matched against the parameter's value text
+juce::var parseValue(const juce::String& text) {
+  if (text.containsOnly("0123456789.-+eE") && text.containsAnyOf("0123456789"))
+    return text.getDoubleValue();
+  return text;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  using namespace audio_plugin_render;
+
+  // The processor's parameter tree uses timers and async updates
+  juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+  RenderSpec spec;
+  juce::NamedValueSet overrides;
+  int numThreads = juce::SystemStats::getNumCpus();
+  auto outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile("rendered");
+  juce::Array<juce::File> inputs;
+
+  for (int i = 1; i < argc; ++i) {
+    const juce::String arg(argv[i]);
+    const bool hasValue = i + 1 < argc;
+
+    if (arg == "--help" || arg == "-h") {
+      std::cout << usage;
+      return 0;
+    }
+
+    if (arg.startsWith("--") && !hasValue) {
+      std::cerr << "Missing value for " << arg << "\n" << usage;
+      return 1;
+    }
+
+    if (arg == "--spec") {
+      const auto specFile = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+      const auto error = parseSpec(juce::JSON::parse(specFile), spec);
+      if (error.isNotEmpty()) {
+        std::cerr << specFile.getFullPathName() << ": " << error << "\n";
+        return 1;
+      }
+    } else if (arg == "--set") {
+      const juce::String assignment(argv[++i]);
+      if (!assignment.contains("=")) {
+        std::cerr << "Expected <id>=<value>, got " << assignment << "\n";
+        return 1;
+      }
+      overrides.set(assignment.upToFirstOccurrenceOf("=", false, false),
+                    parseValue(assignment.fromFirstOccurrenceOf("=", false, false)));
+    } else if (arg == "--block-size") {
+      spec.blockSize = juce::String(argv[++i]).getIntValue();
+    } else if (arg == "--tail") {
+      spec.tailSeconds = juce::String(argv[++i]).getDoubleValue();
+    } else if (arg == "--jobs") {
+      numThreads = juce::String(argv[++i]).getIntValue();
+    } else if (arg == "--out-dir") {
+      outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+    } else if (arg.startsWith("--")) {
+      std::cerr << "Unknown option " << arg << "\n" << usage;
+      return 1;
+    } else {
+      inputs.add(juce::File::getCurrentWorkingDirectory().getChildFile(arg));
+    }
+  }
+
+  for (const auto& value : overrides)
+    spec.parameters.set(value.name, value.value);
+
+  if (inputs.isEmpty() || spec.blockSize <= 0 || numThreads <= 0) {
+    std::cerr << usage;
+    return 1;
+  }
+
+  if (!outputDirectory.createDirectory()) {
+    std::cerr << "Cannot create " << outputDirectory.getFullPathName() << "\n";
+    return 1;
+  }
+
+  const auto results = renderFiles(inputs, outputDirectory, spec, numThreads);
+
+  int failures = 0;
+  double audioSeconds = 0.0;
+  double wallSeconds = 0.0;
+  for (const auto& result : results) {
+    if (!result.ok()) {
+      std::cerr << result.input.getFileName() << ": " << result.error << "\n";
+      ++failures;
+      continue;
+    }
+
+    audioSeconds += result.audioSeconds;
+    wallSeconds += result.wallSeconds;
+    std::cout << result.input.getFileName() << ": "
+              << juce::String(result.audioSeconds, 2) << " s in "
+              << juce::String(result.wallSeconds, 3) << " s ("
+              << juce::String(result.getRealtimeFactor(), 1) << "x real time)\n";
+  }
+
+  if (wallSeconds > 0.0)
+    std::cout << "Rendered " << results.size() - static_cast<size_t>(failures) << " file(s), "
+              << juce::String(audioSeconds / wallSeconds, 1) << "x real time per thread\n";
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,169 @@
+#include "offline_renderer.h"
+#include <plugin_processor.h>
+
+namespace audio_plugin_render {
+namespace {
+juce::String setParameter(audio_plugin::AudioPluginAudioProcessor& processor,
+                          const juce::Identifier& id,
+                          const juce::var& value) {
+  auto* param = processor.getParameters().getParameter(id.toString());
+  if (param == nullptr)
+    return "unknown parameter '" + id.toString() + "'";
+
+  float normalised = 0.0f;
+  if (value.isString())
+    normalised = param->getValueForText(value.toString());  // choice names, "On"/"Off" etc.
+  else if (value.isBool() || value.isInt() || value.isInt64() || value.isDouble())
+    normalised = param->convertTo0to1(static_cast<float>(value));
+  else
+    return "parameter '" + id.toString() + "' needs a number or a string";
+
+  // Notifying updates the value tree's raw values that processBlock reads
+  param->setValueNotifyingHost(normalised);
+  return {};
+}
+}  // namespace
+
+juce::String parseSpec(const juce::var& json, RenderSpec& spec) {
+  if (!json.isObject())
+    return "spec must be a JSON object";
+
+  if (json.hasProperty("blockSize"))
+    spec.blockSize = static_cast<int>(json["blockSize"]);
+  if (json.hasProperty("tailSeconds"))
+    spec.tailSeconds = static_cast<double>(json["tailSeconds"]);
+
+  if (json.hasProperty("parameters")) {
+    auto* parameters = json["parameters"].getDynamicObject();
+    if (parameters == nullptr)
+      return "\"parameters\" must be an object";
+
+    for (const auto& property : parameters->getProperties())
+      spec.parameters.set(property.name, property.value);
+  }
+
+  if (spec.blockSize <= 0)
+    return "blockSize must be positive";
+  return {};
+}
+
+RenderResult renderFile(const juce::File& input, const juce::File& output, const RenderSpec& spec) {
+  RenderResult result;
+  result.input = input;
+  result.output = output;
+
+  if (output == input) {
+    result.error = "output would overwrite " + input.getFullPathName();
+    return result;
+  }
+
+  juce::AudioFormatManager formatManager;
+  formatManager.registerBasicFormats();
+
+  std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(input));
+  if (reader == nullptr) {
+    result.error = "cannot read " + input.getFullPathName();
+    return result;
+  }
+
+  auto* outputFormat = formatManager.findFormatForFileExtension(output.getFileExtension());
+  if (outputFormat == nullptr) {
+    result.error = "no audio format for " + output.getFileName();
+    return result;
+  }
+
+  const auto sampleRate = reader->sampleRate;
+  const auto numChannels = static_cast<int>(reader->numChannels);
+
+  audio_plugin::AudioPluginAudioProcessor processor;
+
+  juce::AudioProcessor::BusesLayout layout;
+  layout.inputBuses.add(juce::AudioChannelSet::canonicalChannelSet(numChannels));
+  layout.outputBuses.add(juce::AudioChannelSet::canonicalChannelSet(numChannels));
+  if (!processor.setBusesLayout(layout)) {
+    result.error = juce::String(numChannels) + " channel files are not supported";
+    return result;
+  }
+
+  for (const auto& parameter : spec.parameters) {
+    result.error = setParameter(processor, parameter.name, parameter.value);
+    if (!result.ok())
+      return result;
+  }
+
+  processor.setNonRealtime(true);
+  processor.setRateAndBufferSizeDetails(sampleRate, spec.blockSize);
+  processor.prepareToPlay(sampleRate, spec.blockSize);
+
+  output.deleteFile();
+  std::unique_ptr<juce::OutputStream> stream(output.createOutputStream());
+  if (stream == nullptr) {
+    result.error = "cannot write " + output.getFullPathName();
+    return result;
+  }
+
+  const int bitsPerSample = reader->usesFloatingPointData ? 32 : reader->bitsPerSample;
+  std::unique_ptr<juce::AudioFormatWriter> writer(outputFormat->createWriterFor(
+      stream.get(), sampleRate, static_cast<unsigned int>(numChannels), bitsPerSample, {}, 0));
+  if (writer == nullptr) {
+    result.error = "cannot create a " + juce::String(bitsPerSample) + " bit " +
+                   outputFormat->getFormatName() + " writer";
+    return result;
+  }
+  stream.release();  // owned by the writer now
+
+  const auto tailSeconds = spec.tailSeconds < 0.0 ? processor.getTailLengthSeconds()
+                                                  : spec.tailSeconds;
+  const auto totalLength =
+      reader->lengthInSamples + static_cast<juce::int64>(std::ceil(tailSeconds * sampleRate));
+
+  juce::AudioBuffer<float> buffer(numChannels, spec.blockSize);
+  juce::MidiBuffer midi;
+
+  const auto startTime = juce::Time::getMillisecondCounterHiRes();
+
+  for (juce::int64 position = 0; position < totalLength; position += spec.blockSize) {
+    const auto numSamples =
+        static_cast<int>(std::min<juce::int64>(spec.blockSize, totalLength - position));
+    juce::AudioBuffer<float> block(buffer.getArrayOfWritePointers(), numChannels, numSamples);
+
+    // Reads past the end of the input are zero filled, which renders the tail
+    reader->read(&block, 0, numSamples, position, true, true);
+    processor.processBlock(block, midi);
+
+    if (!writer->writeFromAudioSampleBuffer(block, 0, numSamples)) {
+      result.error = "write failed for " + output.getFullPathName();
+      break;
+    }
+  }
+
+  writer.reset();  // flushes the header
+  processor.releaseResources();
+
+  result.wallSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+  result.audioSeconds = static_cast<double>(totalLength) / sampleRate;
+  return result;
+}
+
+std::vector<RenderResult> renderFiles(const juce::Array<juce::File>& inputs,
+                                      const juce::File& outputDirectory,
+                                      const RenderSpec& spec,
+                                      int numThreads) {
+  std::vector<RenderResult> results(static_cast<size_t>(inputs.size()));
+
+  juce::ThreadPool pool(juce::jmax(1, numThreads));
+  for (int i = 0; i < inputs.size(); ++i) {
+    pool.addJob([&, i] {
+      const auto& input = inputs.getReference(i);
+      results[static_cast<size_t>(i)] =
+          renderFile(input, outputDirectory.getChildFile(input.getFileName()), spec);
+      return juce::ThreadPoolJob::jobHasFinished;
+    });
+  }
+
+  while (pool.getNumJobs() > 0)
+    juce::Thread::sleep(10);
+
+  return results;
+}
+}  // namespace audio_plugin_render
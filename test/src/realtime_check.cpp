@@ -0,0 +1,263 @@
+#include "realtime_check.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+#if defined(__GLIBC__)
+#define REALTIME_CHECK_LIBC 1
+#include <dlfcn.h>
+#include <malloc.h>
+#include <pthread.h>
+#else
+#define REALTIME_CHECK_LIBC 0
+#endif
+
+#if __has_include(<execinfo.h>)
+#define REALTIME_CHECK_BACKTRACE 1
+#include <execinfo.h>
+#else
+#define REALTIME_CHECK_BACKTRACE 0
+#endif
+
+#if REALTIME_CHECK_LIBC
+// glibc's allocator under its internal names, so the replacements below can forward to it
+extern "C" {
+void* __libc_malloc(std::size_t size);
+void* __libc_calloc(std::size_t count, std::size_t size);
+void* __libc_realloc(void* p, std::size_t size);
+void* __libc_memalign(std::size_t alignment, std::size_t size);
+void __libc_free(void* p);
+}
+#endif
+
+namespace audio_plugin_test {
+namespace {
+thread_local bool checking = false;
+
+std::atomic<int> allocations{0};
+std::atomic<int> locks{0};
+
+// The first violation: which call, and the raw frames (symbolised in getReport)
+const char* firstCall = nullptr;
+constexpr int maxFrames = 48;
+void* frames[maxFrames];
+int numFrames = 0;
+
+void record(const char* call, std::atomic<int>& counter) {
+  if (!checking)
+    return;
+
+  // Nothing below may count itself
+  checking = false;
+  ++counter;
+  if (firstCall == nullptr) {
+    firstCall = call;
+#if REALTIME_CHECK_BACKTRACE
+    numFrames = backtrace(frames, maxFrames);
+#endif
+  }
+  checking = true;
+}
+
+void* rawMalloc(std::size_t size) {
+#if REALTIME_CHECK_LIBC
+  return __libc_malloc(size);
+#else
+  return std::malloc(size);
+#endif
+}
+
+void rawFree(void* p) {
+#if REALTIME_CHECK_LIBC
+  __libc_free(p);
+#else
+  std::free(p);
+#endif
+}
+
+void* checkedNew(std::size_t size, const char* call) {
+  record(call, allocations);
+  return rawMalloc(size == 0 ? 1 : size);
+}
+
+void checkedDelete(void* p, const char* call) {
+  if (p != nullptr)
+    record(call, allocations);
+  rawFree(p);
+}
+}  // namespace
+
+RealtimeCheck::RealtimeCheck() {
+#if REALTIME_CHECK_BACKTRACE
+  // The first backtrace() loads the unwinder, which must not happen inside a check
+  static const int warmUp = [] {
+    void* frame[1];
+    return backtrace(frame, 1);
+  }();
+  (void)warmUp;
+#endif
+
+  allocations = 0;
+  locks = 0;
+  firstCall = nullptr;
+  numFrames = 0;
+  checking = true;
+}
+
+RealtimeCheck::~RealtimeCheck() {
+  checking = false;
+}
+
+int RealtimeCheck::getAllocations() const {
+  return allocations.load();
+}
+
+int RealtimeCheck::getLocks() const {
+  return locks.load();
+}
+
+std::string RealtimeCheck::getReport() const {
+  const bool wasChecking = checking;
+  checking = false;
+
+  std::string report;
+  if (firstCall == nullptr) {
+    report = "no allocations or locks";
+  } else {
+    report = std::to_string(getAllocations()) + " allocation(s) and " +
+             std::to_string(getLocks()) + " lock(s) on the audio thread, the first in " +
+             firstCall + ":\n";
+#if REALTIME_CHECK_BACKTRACE
+    if (char** symbols = backtrace_symbols(frames, numFrames)) {
+      for (int i = 0; i < numFrames; ++i)
+        report += std::string("  ") + symbols[i] + "\n";
+      std::free(symbols);
+    }
+#endif
+  }
+
+  checking = wasChecking;
+  return report;
+}
+
+bool RealtimeCheck::checksLibc() {
+  return REALTIME_CHECK_LIBC != 0;
+}
+}  // namespace audio_plugin_test
+
+using audio_plugin_test::checkedDelete;
+using audio_plugin_test::checkedNew;
+
+void* operator new(std::size_t size) {
+  if (void* p = checkedNew(size, "operator new"))
+    return p;
+  throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+  if (void* p = checkedNew(size, "operator new[]"))
+    return p;
+  throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  return checkedNew(size, "operator new");
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  return checkedNew(size, "operator new[]");
+}
+
+void operator delete(void* p) noexcept {
+  checkedDelete(p, "operator delete");
+}
+
+void operator delete[](void* p) noexcept {
+  checkedDelete(p, "operator delete[]");
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+  checkedDelete(p, "operator delete");
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+  checkedDelete(p, "operator delete[]");
+}
+
+#if REALTIME_CHECK_LIBC
+namespace {
+using audio_plugin_test::allocations;
+using audio_plugin_test::locks;
+using audio_plugin_test::record;
+
+// The next definition of a libc function, looked up on first use
+template <typename Fn>
+Fn* next(std::atomic<Fn*>& slot, const char* name) {
+  Fn* fn = slot.load(std::memory_order_acquire);
+  if (fn == nullptr) {
+    fn = reinterpret_cast<Fn*>(dlsym(RTLD_NEXT, name));
+    slot.store(fn, std::memory_order_release);
+  }
+  return fn;
+}
+
+std::atomic<int (*)(pthread_mutex_t*)> realMutexLock{nullptr};
+std::atomic<int (*)(pthread_rwlock_t*)> realReadLock{nullptr};
+std::atomic<int (*)(pthread_rwlock_t*)> realWriteLock{nullptr};
+}  // namespace
+
+extern "C" {
+void* malloc(std::size_t size) noexcept {
+  record("malloc", allocations);
+  return __libc_malloc(size);
+}
+
+void* calloc(std::size_t count, std::size_t size) noexcept {
+  record("calloc", allocations);
+  return __libc_calloc(count, size);
+}
+
+void* realloc(void* p, std::size_t size) noexcept {
+  record("realloc", allocations);
+  return __libc_realloc(p, size);
+}
+
+void* memalign(std::size_t alignment, std::size_t size) noexcept {
+  record("memalign", allocations);
+  return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(std::size_t alignment, std::size_t size) noexcept {
+  record("aligned_alloc", allocations);
+  return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** p, std::size_t alignment, std::size_t size) noexcept {
+  record("posix_memalign", allocations);
+  *p = __libc_memalign(alignment, size);
+  return *p != nullptr || size == 0 ? 0 : ENOMEM;
+}
+
+void free(void* p) noexcept {
+  if (p != nullptr)
+    record("free", allocations);
+  __libc_free(p);
+}
+
+int pthread_mutex_lock(pthread_mutex_t* mutex) noexcept {
+  record("pthread_mutex_lock", locks);
+  return next(realMutexLock, "pthread_mutex_lock")(mutex);
+}
+
+int pthread_rwlock_rdlock(pthread_rwlock_t* lock) noexcept {
+  record("pthread_rwlock_rdlock", locks);
+  return next(realReadLock, "pthread_rwlock_rdlock")(lock);
+}
+
+int pthread_rwlock_wrlock(pthread_rwlock_t* lock) noexcept {
+  record("pthread_rwlock_wrlock", locks);
+  return next(realWriteLock, "pthread_rwlock_wrlock")(lock);
+}
+}
+#endif
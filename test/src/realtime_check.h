@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+
+namespace audio_plugin_test {
+/**
+ * Catches work an audio callback must not do: allocating or freeing memory and blocking on
+ * a lock.
+ *
+ * The test binary replaces operator new/delete everywhere and, on glibc, malloc, calloc,
+ * realloc, free, pthread_mutex_lock and pthread_rwlock_(rd|wr)lock. Each replacement
+ * forwards to the real function, but while a RealtimeCheck is alive on the calling
+ * thread it also counts the call and keeps a stack trace of the first one. Condition
+ * variables are not checked separately: waiting on one needs a locked mutex first.
+ */
+class RealtimeCheck {
+public:
+  // Checks the calling thread until destroyed; not nestable
+  RealtimeCheck();
+  ~RealtimeCheck();
+
+  RealtimeCheck(const RealtimeCheck&) = delete;
+  RealtimeCheck& operator=(const RealtimeCheck&) = delete;
+
+  int getAllocations() const;
+  int getLocks() const;
+  bool passed() const { return getAllocations() == 0 && getLocks() == 0; }
+
+  // What was caught first and where, for the failure message
+  std::string getReport() const;
+
+  // Whether malloc and pthread locks are checked as well as operator new
+  static bool checksLibc();
+};
+}  // namespace audio_plugin_test
@@ -1,8 +1,135 @@
 #include <plugin_processor.h>
 #include <gtest/gtest.h>
+#include "realtime_check.h"
 
 namespace audio_plugin_test {
+namespace {
+void setValue(audio_plugin::AudioPluginAudioProcessor& processor, const char* id, float value) {
+  auto* param = processor.getParameters().getParameter(id);
+  ASSERT_NE(param, nullptr) << id;
+  param->setValueNotifyingHost(param->convertTo0to1(value));
+}
+
+float getValue(audio_plugin::AudioPluginAudioProcessor& processor, const char* id) {
+  return processor.getParameters().getRawParameterValue(id)->load();
+}
+}  // namespace
+
 TEST(AudioProcessor, Foo) {
   audio_plugin::AudioPluginAudioProcessor processor{};
 }
+
+TEST(AudioProcessor, StateRestoresParametersAndPresets) {
+  audio_plugin::AudioPluginAudioProcessor source;
+  setValue(source, "feedback", 0.7f);
+  setValue(source, "mode", 2.0f);
+  source.storePreset("Long");
+  setValue(source, "feedback", 0.1f);
+  setValue(source, "channelOffset3", 0.25f);
+
+  juce::MemoryBlock state;
+  source.getStateInformation(state);
+
+  audio_plugin::AudioPluginAudioProcessor restored;
+  restored.setStateInformation(state.getData(), static_cast<int>(state.getSize()));
+
+  EXPECT_FLOAT_EQ(getValue(restored, "feedback"), 0.1f);
+  EXPECT_FLOAT_EQ(getValue(restored, "mode"), 2.0f);
+  EXPECT_FLOAT_EQ(getValue(restored, "channelOffset3"), 0.25f);
+
+  ASSERT_EQ(restored.getNumPresets(), 2);
+  EXPECT_EQ(restored.getPresetName(1), "Long");
+  EXPECT_EQ(restored.getCurrentProgram(), 1);
+  ASSERT_TRUE(restored.recallPreset(1));
+  EXPECT_FLOAT_EQ(getValue(restored, "feedback"), 0.7f);
+  EXPECT_FLOAT_EQ(getValue(restored, "channelOffset3"), 0.0f);
+
+  // Anything else is ignored rather than half applied
+  const char garbage[] = "not a state";
+  restored.setStateInformation(garbage, sizeof(garbage));
+  EXPECT_FLOAT_EQ(getValue(restored, "feedback"), 0.7f);
+}
+
+// Recalls between blocks: swapping presets in costs the audio thread no allocation or lock
+TEST(AudioProcessor, PresetRecallIsRealtimeSafe) {
+  audio_plugin::AudioPluginAudioProcessor processor;
+  processor.prepareToPlay(48000.0, 256);
+
+  setValue(processor, "delayTime", 0.2f);
+  setValue(processor, "feedback", 0.8f);
+  const int a = processor.storePreset("A");
+  setValue(processor, "delayTime", 1.1f);
+  setValue(processor, "feedback", 0.2f);
+  setValue(processor, "mode", 0.0f);
+  const int b = processor.storePreset("B");
+
+  juce::AudioBuffer<float> buffer(2, 256);
+  juce::MidiBuffer midi;
+  juce::Random random(17);
+  for (int block = 0; block < 200; ++block) {
+    if (block % 10 == 0)
+      processor.recallPreset(block % 20 == 0 ? a : b);
+
+    for (int c = 0; c < buffer.getNumChannels(); ++c)
+      for (int i = 0; i < buffer.getNumSamples(); ++i)
+        buffer.setSample(c, i, random.nextFloat() - 0.5f);
+
+    std::string report;
+    {
+      RealtimeCheck check;
+      processor.processBlock(buffer, midi);
+      if (!check.passed())
+        report = check.getReport();
+    }
+    ASSERT_TRUE(report.empty()) << "block " << block << ": " << report;
+  }
+
+  EXPECT_FLOAT_EQ(getValue(processor, "feedback"), 0.2f);
+  processor.releaseResources();
+}
+
+// Hosts rendering in double precision get a line of doubles, so the repeats follow the float
+// result without its rounding, and the audio thread allocates no conversion buffers
+TEST(AudioProcessor, DoublePrecisionBlocksFollowFloatBlocks) {
+  audio_plugin::AudioPluginAudioProcessor floatProcessor, doubleProcessor;
+  ASSERT_TRUE(doubleProcessor.supportsDoublePrecisionProcessing());
+  doubleProcessor.setProcessingPrecision(juce::AudioProcessor::doublePrecision);
+  for (auto* processor : {&floatProcessor, &doubleProcessor}) {
+    setValue(*processor, "delayTime", 0.01f);
+    setValue(*processor, "feedback", 0.6f);
+    processor->prepareToPlay(48000.0, 256);
+  }
+
+  juce::AudioBuffer<float> floats(2, 256);
+  juce::AudioBuffer<double> doubles(2, 256);
+  juce::MidiBuffer midi;
+  juce::Random random(5);
+  for (int block = 0; block < 20; ++block) {
+    for (int c = 0; c < floats.getNumChannels(); ++c) {
+      for (int i = 0; i < floats.getNumSamples(); ++i) {
+        const float x = block < 4 ? random.nextFloat() - 0.5f : 0.0f;
+        floats.setSample(c, i, x);
+        doubles.setSample(c, i, x);
+      }
+    }
+
+    floatProcessor.processBlock(floats, midi);
+    std::string report;
+    {
+      RealtimeCheck check;
+      doubleProcessor.processBlock(doubles, midi);
+      if (!check.passed())
+        report = check.getReport();
+    }
+    ASSERT_TRUE(report.empty()) << "block " << block << ": " << report;
+
+    for (int c = 0; c < floats.getNumChannels(); ++c)
+      for (int i = 0; i < floats.getNumSamples(); ++i)
+        ASSERT_NEAR(static_cast<double>(floats.getSample(c, i)), doubles.getSample(c, i), 1.0e-4)
+            << "block " << block << ", channel " << c << ", sample " << i;
+  }
+
+  floatProcessor.releaseResources();
+  doubleProcessor.releaseResources();
+}
 }  // namespace audio_plugin_test
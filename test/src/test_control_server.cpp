@@ -0,0 +1,255 @@
+#include <plugin_processor.h>
+#include <gtest/gtest.h>
+
+#if CONTROL_SOCKET
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+#include "realtime_check.h"
+
+namespace audio_plugin_test {
+namespace {
+std::string getTestSocketPath(const char* name) {
+  return "/tmp/delay-test-" + std::to_string(getpid()) + "-" + name + ".sock";
+}
+
+// The control daemon's side: one request line out, one reply line back
+class TestClient {
+public:
+  explicit TestClient(const std::string& path) : socket(::socket(AF_UNIX, SOCK_STREAM, 0)) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    connected = connect(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+  }
+  ~TestClient() { close(socket); }
+
+  bool isConnected() const { return connected; }
+
+  std::string request(const std::string& line) {
+    const auto message = line + "\n";
+    if (send(socket, message.data(), message.size(), 0) != static_cast<ssize_t>(message.size()))
+      return "send failed";
+
+    std::string reply;
+    char c;
+    while (recv(socket, &c, 1, 0) == 1 && c != '\n')
+      reply += c;
+    return reply;
+  }
+
+private:
+  int socket;
+  bool connected = false;
+};
+
+std::vector<ControlServer::Parameter> makeParameters() {
+  return {{"level", {0.0f, 1.0f}}, {"choice", {0.0f, 4.0f, 1.0f}}};
+}
+
+std::vector<std::pair<size_t, float>> drain(ControlServer& server, int maxChanges) {
+  std::vector<std::pair<size_t, float>> changes;
+  changes.reserve(ControlServer::capacity);
+
+  std::string report;
+  {
+    RealtimeCheck check;
+    server.drainChanges(maxChanges,
+                        [&](size_t index, float value) { changes.emplace_back(index, value); });
+    if (!check.passed())
+      report = check.getReport();
+  }
+  EXPECT_TRUE(report.empty()) << report;
+  return changes;
+}
+}  // namespace
+
+TEST(ControlServer, BatchesReachTheAudioThreadWhole) {
+  const auto path = getTestSocketPath("batches");
+  ControlServer server(path, makeParameters(), nullptr);
+  ASSERT_TRUE(server.isListening());
+
+  TestClient client(path);
+  ASSERT_TRUE(client.isConnected());
+
+  EXPECT_EQ(client.request("set level 0.5 choice 2.6"), "ok");
+  EXPECT_EQ(client.request("set level 2"), "ok");  // clamped to the range
+
+  // Nothing of a batch with a mistake in it is queued
+  EXPECT_EQ(client.request("set level 0.1 volume 3"), "error unknown parameter \"volume\"");
+  EXPECT_EQ(client.request("set level loud"), "error bad value for level");
+  EXPECT_EQ(client.request("set level"), "error expected set <id> <value> ...");
+
+  const auto changes = drain(server, ControlServer::maxChangesPerBlock);
+  ASSERT_EQ(changes.size(), 3u);
+  EXPECT_EQ(changes[0], std::make_pair(size_t{0}, 0.5f));
+  EXPECT_EQ(changes[1], std::make_pair(size_t{1}, 3.0f));  // snapped to a choice
+  EXPECT_EQ(changes[2], std::make_pair(size_t{0}, 1.0f));
+  EXPECT_TRUE(drain(server, ControlServer::maxChangesPerBlock).empty());
+
+  // The message thread sees the latest value of each
+  std::vector<std::pair<size_t, float>> latest;
+  server.forEachParameterChange(
+      [&](size_t index, float value) { latest.emplace_back(index, value); });
+  ASSERT_EQ(latest.size(), 2u);
+  EXPECT_EQ(latest[0], std::make_pair(size_t{0}, 1.0f));
+  EXPECT_EQ(latest[1], std::make_pair(size_t{1}, 3.0f));
+}
+
+// A block drains whole batches up to its budget and leaves the rest for the next ones
+TEST(ControlServer, DrainPerBlockIsBounded) {
+  const auto path = getTestSocketPath("bounded");
+  ControlServer server(path, makeParameters(), nullptr);
+  TestClient client(path);
+  ASSERT_TRUE(client.isConnected());
+
+  std::string batch = "set";
+  for (int k = 0; k < 20; ++k)
+    batch += " level 0.25 choice 1";
+  for (int b = 0; b < 3; ++b)
+    ASSERT_EQ(client.request(batch), "ok");
+
+  EXPECT_EQ(drain(server, ControlServer::maxChangesPerBlock).size(), 40u);
+  EXPECT_EQ(drain(server, ControlServer::maxChangesPerBlock).size(), 40u);
+  EXPECT_EQ(drain(server, ControlServer::maxChangesPerBlock).size(), 40u);
+  EXPECT_TRUE(drain(server, ControlServer::maxChangesPerBlock).empty());
+
+  // Larger batches could not be drained in one block, so they are refused
+  batch = "set";
+  for (int k = 0; k <= ControlServer::maxChangesPerBlock / 2; ++k)
+    batch += " level 0.25 choice 1";
+  EXPECT_EQ(client.request(batch), "error more than 64 changes");
+
+  // With no audio thread draining, the FIFO fills up and further batches are refused
+  batch = "set";
+  for (int k = 0; k < 25; ++k)
+    batch += " level 0.25 choice 1";
+  std::string reply;
+  for (int b = 0; b < 10 && reply != "error busy"; ++b)
+    reply = client.request(batch);
+  EXPECT_EQ(reply, "error busy");
+}
+
+TEST(ControlServer, PresetRequestsAndStatus) {
+  const auto path = getTestSocketPath("status");
+  ControlServer server(path, makeParameters(), [] {
+    auto* object = new juce::DynamicObject();
+    object->setProperty("tailSeconds", 1.5);
+    return juce::var(object);
+  });
+  TestClient client(path);
+  ASSERT_TRUE(client.isConnected());
+
+  server.setNumPresets(3);
+
+  // A request that is refused leaves what was set before it in place
+  EXPECT_EQ(client.request("set level 0.5"), "ok");
+  EXPECT_EQ(client.request("preset 3"), "error no preset 3 of 3");
+  EXPECT_EQ(client.request("preset first"), "error expected preset <index>");
+  EXPECT_EQ(server.takePresetRequest(), -1);
+  int numChanged = 0;
+  server.forEachParameterChange([&](size_t, float) { ++numChanged; });
+  EXPECT_EQ(numChanged, 1);
+
+  // The recall supersedes what was set before it
+  EXPECT_EQ(client.request("set level 0.25"), "ok");
+  EXPECT_EQ(client.request("preset 2"), "ok");
+  EXPECT_EQ(server.takePresetRequest(), 2);
+  EXPECT_EQ(server.takePresetRequest(), -1);
+  numChanged = 0;
+  server.forEachParameterChange([&](size_t, float) { ++numChanged; });
+  EXPECT_EQ(numChanged, 0);
+
+  const auto status = juce::JSON::parse(juce::String(client.request("status")));
+  EXPECT_EQ(static_cast<double>(status.getProperty("tailSeconds", 0.0)), 1.5);
+  EXPECT_EQ(client.request("reboot"), "error unknown request \"reboot\"");
+}
+
+// End to end: a batch set over the socket is in effect from the next block on
+TEST(ControlServer, ProcessorAppliesSetsInTheNextBlock) {
+  const auto path = getTestSocketPath("processor");
+  setenv("DELAY_CONTROL_SOCKET", path.c_str(), 1);
+  audio_plugin::AudioPluginAudioProcessor processor;
+  unsetenv("DELAY_CONTROL_SOCKET");
+  processor.prepareToPlay(48000.0, 256);
+
+  TestClient client(path);
+  ASSERT_TRUE(client.isConnected());
+
+  juce::AudioBuffer<float> buffer(2, 256);
+  juce::MidiBuffer midi;
+  buffer.clear();
+  processor.processBlock(buffer, midi);
+  const double tailBefore = processor.getTailLengthSeconds();
+
+  ASSERT_EQ(client.request("set feedback 0.95 delayTime 2"), "ok");
+
+  std::string report;
+  {
+    RealtimeCheck check;
+    processor.processBlock(buffer, midi);
+    if (!check.passed())
+      report = check.getReport();
+  }
+  ASSERT_TRUE(report.empty()) << report;
+  EXPECT_GT(processor.getTailLengthSeconds(), tailBefore * 4.0);
+
+  const auto status = juce::JSON::parse(juce::String(client.request("status")));
+  EXPECT_TRUE(status.getProperty("parameters", {}).hasProperty("feedback"));
+
+  processor.releaseResources();
+}
+
+// A recall drops what was set over the socket before it, also where the preset has the value
+// the parameter was at when the set arrived
+TEST(ControlServer, PresetRecallReplacesEarlierSets) {
+  const auto path = getTestSocketPath("recall");
+  setenv("DELAY_CONTROL_SOCKET", path.c_str(), 1);
+  audio_plugin::AudioPluginAudioProcessor processor;
+  unsetenv("DELAY_CONTROL_SOCKET");
+  processor.prepareToPlay(48000.0, 256);
+  const int preset = processor.storePreset("Default");
+
+  TestClient client(path);
+  ASSERT_TRUE(client.isConnected());
+
+  juce::AudioBuffer<float> buffer(2, 256);
+  juce::MidiBuffer midi;
+  buffer.clear();
+  processor.processBlock(buffer, midi);
+  const double tailBefore = processor.getTailLengthSeconds();
+
+  ASSERT_EQ(client.request("set feedback 0.95 delayTime 2"), "ok");
+  processor.processBlock(buffer, midi);
+  ASSERT_GT(processor.getTailLengthSeconds(), tailBefore * 4.0);
+
+  ASSERT_TRUE(processor.recallPreset(preset));
+  processor.processBlock(buffer, midi);
+  EXPECT_DOUBLE_EQ(processor.getTailLengthSeconds(), tailBefore);
+
+  processor.releaseResources();
+}
+
+// Every instance on the device gets a socket of its own, and reports where it is
+TEST(ControlServer, InstancesListenOnTheirOwnSockets) {
+  const auto path = getTestSocketPath("instances");
+  setenv("DELAY_CONTROL_SOCKET", path.c_str(), 1);
+  audio_plugin::AudioPluginAudioProcessor first, second;
+  unsetenv("DELAY_CONTROL_SOCKET");
+
+  const auto secondPath = path.substr(0, path.size() - 5) + "-1.sock";
+  EXPECT_EQ(first.getControlSocketPath().toStdString(), path);
+  EXPECT_EQ(second.getControlSocketPath().toStdString(), secondPath);
+
+  TestClient client(secondPath);
+  ASSERT_TRUE(client.isConnected());
+  const auto status = juce::JSON::parse(juce::String(client.request("status")));
+  EXPECT_EQ(status.getProperty("socket", {}).toString().toStdString(), secondPath);
+}
+}  // namespace audio_plugin_test
+#endif
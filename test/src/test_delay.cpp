@@ -0,0 +1,541 @@
+#include <delay.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace audio_plugin_test {
+namespace {
+// Largest second difference of the output, a measure of how abruptly it changes
+struct Roughness {
+  float process(const float* samples, int numSamples) {
+    float largest = 0.0f;
+    for (int i = 0; i < numSamples; ++i) {
+      largest = std::max(largest, std::abs(samples[i] - 2.0f * y1 + y2));
+      y2 = y1;
+      y1 = samples[i];
+    }
+    return largest;
+  }
+
+  float y1 = 0.0f, y2 = 0.0f;
+};
+}  // namespace
+
+// Without feedback, ping-pong writes nothing to the right channel where stereo writes its
+// input, so the right repeats must fade out (and back in) rather than stop dead
+TEST(Delay, ModeChangeFadesBetweenFeedbackTopologies) {
+  const double sampleRate = 48000.0;
+  const int blockSize = 256;
+
+  for (auto kernel : {Delay::Kernel::Simd, Delay::Kernel::Scalar}) {
+    Delay delay;
+    delay.setKernel(kernel);
+    delay.setSampleRate(sampleRate);
+
+    Delay::Parameters params;
+    params.delayTimeSeconds = 0.1f;
+    params.feedback = 0.0f;
+    params.wetLevel = 1.0f;
+    params.dryLevel = 0.0f;
+    params.modulationDepthSeconds = 0.0f;
+    params.mode = Delay::DelayMode::Stereo;
+    delay.setParameters(params);
+
+    std::vector<float> left(blockSize), right(blockSize);
+    Roughness roughness;
+    long position = 0;
+    auto process = [&](double seconds) {
+      float largest = 0.0f;
+      for (int block = 0; block < static_cast<int>(seconds * sampleRate) / blockSize; ++block) {
+        for (int i = 0; i < blockSize; ++i, ++position) {
+          left[i] = 0.0f;
+          right[i] = 0.5f * std::sin(static_cast<float>(position) * 0.04f);
+        }
+        delay.processStereo(left.data(), right.data(), blockSize);
+        largest = std::max(largest, roughness.process(right.data(), blockSize));
+      }
+      return largest;
+    };
+
+    process(0.5);
+    const float steady = process(0.5);
+
+    params.mode = Delay::DelayMode::PingPong;
+    delay.setParameters(params);
+    EXPECT_LT(process(0.5), 1.5f * steady);
+
+    params.mode = Delay::DelayMode::Stereo;
+    delay.setParameters(params);
+    EXPECT_LT(process(0.5), 1.5f * steady);
+  }
+}
+
+// The network spreads an impulse on one side over both and into many more repeats than the
+// Stereo mode's, and its repeats still die away, as a mono buffer's do
+TEST(Delay, DiffuseRepeatsSpreadAndDecay) {
+  const double sampleRate = 48000.0;
+  const int blockSize = 256;
+  const int numBlocks = static_cast<int>(3.0 * sampleRate) / blockSize;
+
+  Delay::Parameters params;
+  params.delayTimeSeconds = 0.05f;
+  params.feedback = 0.8f;
+  params.wetLevel = 1.0f;
+  params.dryLevel = 0.0f;
+  params.modulationDepthSeconds = 0.0f;
+
+  struct Response {
+    int numAudible = 0;  // samples of either side above -60 dB
+    double energy[2] = {};
+    double firstSecond = 0.0, lastSecond = 0.0;
+  };
+
+  auto respond = [&](int numChannels, Delay::DelayMode mode) {
+    params.mode = mode;
+    Delay delay;
+    delay.setNumChannels(numChannels);
+    delay.setNetworkLayout(mode == Delay::DelayMode::Diffuse);
+    delay.setSampleRate(sampleRate);
+    delay.setParameters(params);
+
+    Response response;
+    std::vector<float> left(blockSize), right(blockSize);
+    for (int block = 0; block < numBlocks; ++block) {
+      std::fill(left.begin(), left.end(), 0.0f);
+      std::fill(right.begin(), right.end(), 0.0f);
+      if (block == 0)
+        left[0] = 1.0f;
+
+      if (numChannels == 1)
+        delay.processMono(left.data(), blockSize);
+      else
+        delay.processStereo(left.data(), right.data(), blockSize);
+
+      for (int i = 0; i < blockSize; ++i) {
+        const double l = left[static_cast<size_t>(i)], r = right[static_cast<size_t>(i)];
+        response.numAudible += std::max(std::abs(l), std::abs(r)) > 1.0e-3 ? 1 : 0;
+        response.energy[0] += l * l;
+        response.energy[1] += r * r;
+        if (block < numBlocks / 3)
+          response.firstSecond += l * l + r * r;
+        else if (block >= numBlocks - numBlocks / 3)
+          response.lastSecond += l * l + r * r;
+      }
+    }
+    return response;
+  };
+
+  const auto stereo = respond(2, Delay::DelayMode::Stereo);
+  const auto diffuse = respond(2, Delay::DelayMode::Diffuse);
+  EXPECT_EQ(stereo.energy[1], 0.0);
+  EXPECT_GT(diffuse.energy[1], 0.1 * diffuse.energy[0]);
+  EXPECT_GT(diffuse.numAudible, 10 * stereo.numAudible);
+  EXPECT_LT(diffuse.lastSecond, 0.01 * diffuse.firstSecond);
+
+  const auto mono = respond(1, Delay::DelayMode::Diffuse);
+  EXPECT_GT(mono.numAudible, 10 * stereo.numAudible);
+  EXPECT_LT(mono.lastSecond, 0.01 * mono.firstSecond);
+}
+
+// Changing to and from the Diffuse mode swaps in a line of the other layout, which waits for
+// the running kernel's routing to ramp out, so neither change is heard as a step
+TEST(Delay, DiffuseLayoutChangesAreSmooth) {
+  const double sampleRate = 48000.0;
+  const int blockSize = 256;
+
+  Delay delay;
+  delay.setSampleRate(sampleRate);
+
+  Delay::Parameters params;
+  params.delayTimeSeconds = 0.1f;
+  params.feedback = 0.5f;
+  params.wetLevel = 1.0f;
+  params.dryLevel = 0.0f;
+  params.modulationDepthSeconds = 0.0f;
+  params.mode = Delay::DelayMode::Stereo;
+  delay.setParameters(params);
+
+  std::vector<float> left(blockSize), right(blockSize);
+  Roughness roughness;
+  long position = 0;
+  auto process = [&](double seconds) {
+    float largest = 0.0f;
+    for (int block = 0; block < static_cast<int>(seconds * sampleRate) / blockSize; ++block) {
+      for (int i = 0; i < blockSize; ++i, ++position) {
+        left[i] = 0.5f * std::sin(static_cast<float>(position) * 0.04f);
+        right[i] = 0.5f * std::sin(static_cast<float>(position) * 0.03f);
+      }
+      delay.processStereo(left.data(), right.data(), blockSize);
+      delay.releaseRetiredDelayLine();
+      largest = std::max(largest, roughness.process(left.data(), blockSize));
+    }
+    return largest;
+  };
+
+  auto changeMode = [&](Delay::DelayMode mode) {
+    params.mode = mode;
+    delay.setParameters(params);
+    delay.submitDelayLine(delay.createDelayLine(delay.getMaxDelayTime(), delay.getStorageFormat(),
+                                                mode == Delay::DelayMode::Diffuse));
+  };
+
+  process(0.5);
+  const float stereo = process(0.5);
+  const size_t stereoBytes = delay.getDelayLineBytes();
+
+  changeMode(Delay::DelayMode::Diffuse);
+  const float toDiffuse = process(0.5);
+  const float diffuse = process(0.5);
+  EXPECT_EQ(delay.getDelayLineBytes(), 2 * stereoBytes);
+  EXPECT_LT(toDiffuse, 1.5f * std::max(stereo, diffuse));
+
+  changeMode(Delay::DelayMode::Stereo);
+  const float toStereo = process(0.5);
+  EXPECT_EQ(delay.getDelayLineBytes(), stereoBytes);
+  EXPECT_LT(toStereo, 1.5f * std::max(stereo, diffuse));
+}
+
+// An impulse comes back once from every tap, at its time, level and pan, whichever kernel
+// reads the line; the second group of four taps is read as well
+TEST(Delay, TapsEchoAtTheirOwnTimeLevelAndPan) {
+  const double sampleRate = 48000.0;
+  const int blockSize = 100;  // runs are split at the taps' run length and block edges
+
+  Delay::Parameters params;
+  params.delayTimeSeconds = 0.5f;  // the main repeat comes after the window checked
+  params.feedback = 0.0f;
+  params.wetLevel = 1.0f;
+  params.dryLevel = 0.0f;
+  params.modulationDepthSeconds = 0.0f;
+  params.numTaps = 5;
+  params.taps[0] = {0.01f, 0.0f, 1.0f, -1.0f};
+  params.taps[1] = {0.02f, 0.0f, 0.5f, 1.0f};
+  params.taps[2] = {0.03f, 0.0f, 0.25f, 0.0f};
+  params.taps[3] = {0.04f, 0.0f, 0.0f, 0.0f};
+  params.taps[4] = {0.05f, 0.0f, 0.125f, 0.0f};
+  params.taps[5] = {0.06f, 0.0f, 1.0f, 0.0f};  // past numTaps, so silent
+
+  struct Echo {
+    int position;
+    float left, right;
+  };
+  const std::vector<Echo> echoes = {
+      {480, 1.0f, 0.0f}, {960, 0.0f, 0.5f}, {1440, 0.25f, 0.25f}, {2400, 0.125f, 0.125f}};
+  const int numSamples = 30 * blockSize;
+
+  for (auto kernel : {Delay::Kernel::Simd, Delay::Kernel::Scalar}) {
+    Delay delay;
+    delay.setKernel(kernel);
+    delay.setSampleRate(sampleRate);
+    delay.setParameters(params);
+
+    std::vector<float> left(numSamples, 0.0f), right(numSamples, 0.0f);
+    left[0] = right[0] = 1.0f;
+    for (int start = 0; start < numSamples; start += blockSize)
+      delay.processStereo(left.data() + start, right.data() + start, blockSize);
+
+    for (int i = 0; i < numSamples; ++i) {
+      float expectedL = 0.0f, expectedR = 0.0f;
+      for (const auto& echo : echoes) {
+        if (echo.position == i) {
+          expectedL = echo.left;
+          expectedR = echo.right;
+        }
+      }
+      ASSERT_NEAR(left[static_cast<size_t>(i)], expectedL, 1.0e-5f) << "sample " << i;
+      ASSERT_NEAR(right[static_cast<size_t>(i)], expectedR, 1.0e-5f) << "sample " << i;
+    }
+  }
+
+  // Mono sums both sides of each tap's pan
+  Delay delay;
+  delay.setNumChannels(1);
+  delay.setSampleRate(sampleRate);
+  delay.setParameters(params);
+
+  std::vector<float> samples(numSamples, 0.0f);
+  samples[0] = 1.0f;
+  for (int start = 0; start < numSamples; start += blockSize)
+    delay.processMono(samples.data() + start, blockSize);
+
+  for (const auto& echo : echoes)
+    EXPECT_NEAR(samples[static_cast<size_t>(echo.position)], 0.5f * (echo.left + echo.right),
+                1.0e-5f);
+}
+
+// The filter sits in the feedback path, so the low-cut keeps a constant input from building
+// up in the line (to input / (1 - feedback) without it), in every kernel and mode
+TEST(Delay, LowCutStopsBuildUpInTheRepeats) {
+  const double sampleRate = 48000.0;
+  const int blockSize = 256;
+
+  Delay::Parameters params;
+  params.delayTimeSeconds = 0.05f;
+  params.feedback = 0.9f;
+  params.wetLevel = 1.0f;
+  params.modulationDepthSeconds = 0.0f;
+  params.lowCutFreq = 200.0f;
+
+  auto steadyLevel = [&](int numChannels, Delay::Kernel kernel, Delay::DelayMode mode) {
+    params.mode = mode;
+    Delay delay;
+    delay.setKernel(kernel);
+    delay.setNumChannels(numChannels);
+    delay.setNetworkLayout(mode == Delay::DelayMode::Diffuse);
+    delay.setSampleRate(sampleRate);
+    delay.setParameters(params);
+
+    std::vector<std::vector<float>> buffers(static_cast<size_t>(numChannels),
+                                            std::vector<float>(blockSize));
+    std::vector<float*> channels;
+    for (auto& buffer : buffers)
+      channels.push_back(buffer.data());
+
+    for (int block = 0; block < static_cast<int>(2.0 * sampleRate) / blockSize; ++block) {
+      for (auto& buffer : buffers)
+        std::fill(buffer.begin(), buffer.end(), 0.5f);
+      if (numChannels == 2)
+        delay.processStereo(channels[0], channels[1], blockSize);
+      else
+        delay.processMultichannel(channels.data(), blockSize);
+    }
+
+    float level = 0.0f;
+    delay.getRepeatLevels(&level, 1, blockSize);
+    return level;
+  };
+
+  for (auto mode :
+       {Delay::DelayMode::Stereo, Delay::DelayMode::PingPong, Delay::DelayMode::Diffuse}) {
+    for (auto kernel : {Delay::Kernel::Simd, Delay::Kernel::Scalar})
+      EXPECT_LT(steadyLevel(2, kernel, mode), 0.6f) << static_cast<int>(mode);
+    EXPECT_LT(steadyLevel(4, Delay::Kernel::Simd, mode), 0.6f) << static_cast<int>(mode);
+  }
+}
+
+// Re-preparing at the same rate keeps the old samples and zeroes them a block at a time, so
+// a delay jumping far back right after must read silence rather than the old audio
+TEST(Delay, ReusedLineReadsSilenceWhileBeingCleaned) {
+  const double sampleRate = 48000.0;
+  const int blockSize = 256;
+
+  for (auto kernel : {Delay::Kernel::Simd, Delay::Kernel::Scalar}) {
+    Delay delay;
+    delay.setKernel(kernel);
+    delay.setSampleRate(sampleRate);
+
+    Delay::Parameters params;
+    params.delayTimeSeconds = 0.01f;
+    params.feedback = 0.0f;
+    params.wetLevel = 1.0f;
+    params.dryLevel = 0.0f;
+    params.modulationDepthSeconds = 0.0f;
+    delay.setParameters(params);
+
+    std::vector<float> left(blockSize), right(blockSize);
+    auto process = [&](double seconds, float input) {
+      float largest = 0.0f;
+      for (int block = 0; block < static_cast<int>(seconds * sampleRate) / blockSize; ++block) {
+        std::fill(left.begin(), left.end(), input);
+        std::fill(right.begin(), right.end(), -input);
+        delay.processStereo(left.data(), right.data(), blockSize);
+        for (int i = 0; i < blockSize; ++i)
+          largest = std::max({largest, std::abs(left[i]), std::abs(right[i])});
+      }
+      return largest;
+    };
+
+    // Fill the whole line, then reuse it with only the short delay's reach zeroed
+    process(2.5, 0.5f);
+    delay.setSampleRate(sampleRate);
+
+    params.delayTimeSeconds = 1.5f;
+    delay.setParameters(params);
+    EXPECT_EQ(process(1.0, 0.01f), 0.0f);
+    EXPECT_NEAR(process(1.0, 0.01f), 0.01f, 1.0e-6f);
+  }
+}
+
+// A line swapped in while processing (here a change to half precision at a 10 s delay) takes
+// the old history over a bounded part per block while the old line goes on being written,
+// and once it has caught up holds the same audio at every delay
+TEST(DelayLine, SwapCarriesHistoryOverInBoundedParts) {
+  const size_t frames = 480000;
+  const size_t blockSize = 256;
+
+  FormattedDelayLine<sample_format::Float32> from;
+  from.prepare(frames, 2);
+  size_t written = 0;
+  auto writeBlock = [&](size_t count) {
+    for (size_t i = 0; i < count; ++i, ++written) {
+      float* frame = from.getWriteFrame();
+      frame[0] = static_cast<float>(written % 1000) / 1000.0f;
+      frame[1] = -frame[0];
+      from.advance();
+    }
+  };
+  writeBlock(frames);
+
+  FormattedDelayLine<sample_format::Float16> to;
+  to.prepare(frames, 2);
+  to.beginHistoryFrom(from, frames);
+
+  const size_t framesPerCall = DelayLine::cleanBytesPerCall / (2 * sizeof(uint16_t));
+  size_t calls = 1;
+  for (; !to.copyHistory(2 * blockSize); ++calls)
+    writeBlock(blockSize);
+  EXPECT_LE(calls, frames / (framesPerCall - blockSize) + 2);
+  EXPECT_GE(to.getReadableDelay(), frames);
+
+  float expected[2], out[2];
+  for (size_t delay : {size_t{1}, size_t{777}, frames / 2, frames}) {
+    from.readFrameAt(delay, expected);
+    to.readFrameAt(delay, out);
+    EXPECT_NEAR(out[0], expected[0], 1.0e-3f) << delay;
+    EXPECT_NEAR(out[1], expected[1], 1.0e-3f) << delay;
+  }
+
+  // Writing on from there lines up with the old line too
+  to.getWriteFrame()[0] = to.getWriteFrame()[1] = 0;
+  to.advance();
+  writeBlock(1);
+  to.readFrameAt(frames, out);
+  from.readFrameAt(frames, expected);
+  EXPECT_NEAR(out[0], expected[0], 1.0e-3f);
+}
+
+// On a Float32 line double buffers go through the same single-precision engine, so input a
+// float can hold comes back as exactly the float result, whichever entry point and kernel
+// process it
+TEST(Delay, DoubleBuffersMatchFloatBuffers) {
+  const int blockSize = 128;
+  const int numBlocks = 40;
+  const int numSamples = blockSize * numBlocks;
+
+  Delay::Parameters params;
+  params.delayTimeSeconds = 0.01f;
+  params.feedback = 0.7f;
+  params.hiCutFreq = 4000.0f;
+  params.modulationDepthSeconds = 0.001f;
+  params.mode = Delay::DelayMode::PingPong;
+  params.numTaps = 2;  // mono and stereo only
+  params.taps[0] = {0.003f, 0.0f, 0.5f, -0.5f};
+  params.taps[1] = {0.007f, 0.0f, 0.25f, 1.0f};
+
+  auto compare = [&](int numChannels, Delay::Kernel kernel) {
+    Delay floatDelay, doubleDelay;
+    for (auto* delay : {&floatDelay, &doubleDelay}) {
+      delay->setKernel(kernel);
+      delay->setNumChannels(numChannels);
+      delay->setSampleRate(48000.0);
+      delay->setParameters(params);
+    }
+
+    std::vector<std::vector<float>> floats(static_cast<size_t>(numChannels));
+    std::vector<std::vector<double>> doubles(static_cast<size_t>(numChannels));
+    for (size_t c = 0; c < floats.size(); ++c) {
+      for (int i = 0; i < numSamples; ++i) {
+        const float x = i < 2000 ? std::sin(static_cast<float>(i * (c + 1)) * 0.01f) : 0.0f;
+        floats[c].push_back(x);
+        doubles[c].push_back(x);
+      }
+    }
+
+    for (int start = 0; start < numSamples; start += blockSize) {
+      std::vector<float*> floatChannels;
+      std::vector<double*> doubleChannels;
+      for (size_t c = 0; c < floats.size(); ++c) {
+        floatChannels.push_back(floats[c].data() + start);
+        doubleChannels.push_back(doubles[c].data() + start);
+      }
+
+      if (numChannels == 1) {
+        floatDelay.processMono(floatChannels[0], blockSize);
+        doubleDelay.processMono(doubleChannels[0], blockSize);
+      } else if (numChannels == 2) {
+        floatDelay.processStereo(floatChannels[0], floatChannels[1], blockSize);
+        doubleDelay.processStereo(doubleChannels[0], doubleChannels[1], blockSize);
+      } else {
+        floatDelay.processMultichannel(floatChannels.data(), blockSize);
+        doubleDelay.processMultichannel(doubleChannels.data(), blockSize);
+      }
+    }
+
+    for (size_t c = 0; c < floats.size(); ++c)
+      for (size_t i = 0; i < static_cast<size_t>(numSamples); ++i)
+        ASSERT_EQ(static_cast<double>(floats[c][i]), doubles[c][i])
+            << numChannels << " channels, channel " << c << ", sample " << i;
+  };
+
+  compare(1, Delay::Kernel::Simd);
+  compare(2, Delay::Kernel::Simd);
+  compare(2, Delay::Kernel::Scalar);
+  compare(4, Delay::Kernel::Simd);
+}
+// On a Float64 line the repeats stay in double precision: hundreds of passes through 0.99
+// feedback still match feedback^k, where every pass through a Float32 line rounds to float
+TEST(Delay, Float64LineKeepsRepeatsInDoublePrecision) {
+  const double sampleRate = 48000.0;
+  const int blockSize = 120;
+  const int numBlocks = 400;
+
+  Delay::Parameters params;
+  params.delayTimeSeconds = 0.0025f;  // 120 samples
+  params.feedback = 0.99f;
+  params.wetLevel = 1.0f;
+  params.dryLevel = 0.0f;
+  params.modulationDepthSeconds = 0.0f;
+  params.interpolation = Delay::Interpolation::None;
+
+  // Largest relative error of the repeats past the fade-in, and how many there were
+  auto measure = [&](int numChannels, Delay::Kernel kernel, Delay::StorageFormat format) {
+    Delay delay;
+    delay.setKernel(kernel);
+    delay.setNumChannels(numChannels);
+    delay.setStorageFormat(format);
+    delay.setSampleRate(sampleRate);
+    delay.setParameters(params);
+
+    std::vector<double> left(blockSize), right(blockSize);
+    const double fb = static_cast<double>(params.feedback);
+    double expected = 1.0, largestError = 0.0;
+    int repeats = 0;
+    for (int block = 0; block < numBlocks; ++block) {
+      std::fill(left.begin(), left.end(), 0.0);
+      std::fill(right.begin(), right.end(), 0.0);
+      if (block == 0)
+        left[0] = right[0] = 1.0;
+
+      if (numChannels == 1)
+        delay.processMono(left.data(), blockSize);
+      else
+        delay.processStereo(left.data(), right.data(), blockSize);
+
+      for (int i = 0; i < blockSize; ++i) {
+        if (left[static_cast<size_t>(i)] == 0.0)
+          continue;
+        if (++repeats > 10)
+          largestError = std::max(
+              largestError, std::abs(left[static_cast<size_t>(i)] - expected) / expected);
+        expected *= fb;
+      }
+    }
+    EXPECT_GT(repeats, numBlocks / 2);
+    return largestError;
+  };
+
+  // A silent tap still runs the taps kernel, which adds to the same output
+  for (int numTaps : {0, 1}) {
+    params.numTaps = numTaps;
+    for (auto kernel : {Delay::Kernel::Simd, Delay::Kernel::Scalar}) {
+      for (int numChannels : {1, 2}) {
+        EXPECT_LT(measure(numChannels, kernel, Delay::StorageFormat::Float64), 1.0e-12)
+            << numChannels << " channels, " << numTaps << " taps";
+        EXPECT_GT(measure(numChannels, kernel, Delay::StorageFormat::Float32), 1.0e-9)
+            << numChannels << " channels, " << numTaps << " taps";
+      }
+    }
+  }
+}
+}  // namespace audio_plugin_test
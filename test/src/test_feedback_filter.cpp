@@ -0,0 +1,130 @@
+#include <feedback_filter.h>
+#include <plugin_processor.h>
+#include <gtest/gtest.h>
+#include <cmath>
+#include "realtime_check.h"
+
+namespace audio_plugin_test {
+namespace {
+float measureGain(FeedbackFilter& filter, double sampleRate, float frequencyHz) {
+  const int numSamples = static_cast<int>(sampleRate / 4);
+  float peak = 0.0f;
+  for (int i = 0; i < numSamples; ++i) {
+    const auto phase = juce::MathConstants<double>::twoPi * frequencyHz * i / sampleRate;
+    filter.tick();
+    const float out = filter.process(static_cast<float>(std::sin(phase)), 0);
+    if (i > numSamples / 2)
+      peak = std::max(peak, std::abs(out));
+  }
+  return peak;
+}
+}  // namespace
+
+TEST(FeedbackFilter, SettlesOnButterworthResponse) {
+  const double sampleRate = 48000.0;
+  FeedbackFilter filter;
+  filter.prepare(sampleRate, 0.05);
+  filter.setCutoff(16000.0f);
+  filter.setCutoff(1000.0f);  // ramps down from 16 kHz
+
+  measureGain(filter, sampleRate, 100.0f);  // let the ramp finish
+
+  EXPECT_NEAR(measureGain(filter, sampleRate, 1000.0f), std::sqrt(0.5f), 0.01f);
+  EXPECT_LT(measureGain(filter, sampleRate, 8000.0f), 0.02f);
+}
+
+// Each slope is -3 dB at the cutoff and falls off at its own rate: an octave above, the
+// analog prototypes of order n are down by 1 / sqrt(1 + 4^n)
+TEST(FeedbackFilter, SteeperSlopesKeepTheCutoff) {
+  const double sampleRate = 48000.0;
+  const std::pair<FeedbackFilter::Slope, int> slopes[] = {
+      {FeedbackFilter::Slope::dB12, 2}, {FeedbackFilter::Slope::dB24, 4},
+      {FeedbackFilter::Slope::dB48, 8}};
+
+  for (const auto& [slope, order] : slopes) {
+    FeedbackFilter filter;
+    filter.prepare(sampleRate, 0.05);
+    filter.setSlope(slope);
+    filter.setCutoff(1000.0f);
+
+    EXPECT_NEAR(measureGain(filter, sampleRate, 1000.0f), std::sqrt(0.5f), 0.01f) << order;
+    const float octaveAbove = 1.0f / std::sqrt(1.0f + std::pow(4.0f, static_cast<float>(order)));
+    EXPECT_NEAR(measureGain(filter, sampleRate, 2000.0f), octaveAbove, octaveAbove * 0.1f)
+        << order;
+  }
+}
+
+TEST(FeedbackFilter, LowCutRemovesLowEndUntilTurnedOff) {
+  const double sampleRate = 48000.0;
+  FeedbackFilter filter;
+  filter.prepare(sampleRate, 0.05);
+  filter.setLowCut(200.0f);
+  EXPECT_TRUE(filter.isActive());
+
+  EXPECT_NEAR(measureGain(filter, sampleRate, 200.0f), std::sqrt(0.5f), 0.01f);
+  EXPECT_NEAR(measureGain(filter, sampleRate, 100.0f), 1.0f / std::sqrt(17.0f), 0.01f);
+  EXPECT_NEAR(measureGain(filter, sampleRate, 5000.0f), 1.0f, 0.01f);
+
+  // Both filters in the cascade
+  filter.setCutoff(2000.0f);
+  EXPECT_NEAR(measureGain(filter, sampleRate, 600.0f), 1.0f, 0.05f);
+  EXPECT_LT(measureGain(filter, sampleRate, 50.0f), 0.1f);
+  EXPECT_LT(measureGain(filter, sampleRate, 8000.0f), 0.1f);
+
+  filter.setLowCut(0.0f);
+  EXPECT_NEAR(measureGain(filter, sampleRate, 50.0f), 1.0f, 0.01f);
+}
+
+// The double-precision process() runs the same cascade with its own state
+TEST(FeedbackFilter, DoublePrecisionFollowsTheFloatResponse) {
+  FeedbackFilter filter;
+  filter.prepare(48000.0, 0.05);
+  filter.setSlope(FeedbackFilter::Slope::dB48);
+  filter.setCutoff(2000.0f);
+  filter.setLowCut(100.0f);
+
+  for (int i = 0; i < 4800; ++i) {
+    const float x = std::sin(static_cast<float>(i) * 0.05f);
+    filter.tick();
+    const float single = filter.process(x, 0);
+    const double precise = filter.process(static_cast<double>(x), 1);
+    ASSERT_NEAR(single, precise, 1.0e-4) << "sample " << i;
+  }
+}
+
+TEST(FeedbackFilter, SweepingInProcessBlockDoesNotAllocate) {
+  const double sampleRate = 48000.0;
+  const int blockSize = 64;
+
+  audio_plugin::AudioPluginAudioProcessor processor;
+  processor.prepareToPlay(sampleRate, blockSize);
+
+  auto* hiCut = processor.getParameters().getParameter("hiCutFreq");
+  ASSERT_NE(hiCut, nullptr);
+
+  juce::AudioBuffer<float> buffer(2, blockSize);
+  juce::MidiBuffer midi;
+
+  for (int block = 0; block < 2000; ++block) {
+    // A triangle sweep over the whole range, a new value every block
+    const float position = static_cast<float>(block % 200) / 100.0f;
+    hiCut->setValueNotifyingHost(position < 1.0f ? position : 2.0f - position);
+
+    for (int c = 0; c < buffer.getNumChannels(); ++c)
+      for (int i = 0; i < blockSize; ++i)
+        buffer.setSample(c, i, std::sin(static_cast<float>(block * blockSize + i) * 0.05f));
+
+    bool passed;
+    std::string report;
+    {
+      RealtimeCheck check;
+      processor.processBlock(buffer, midi);
+      passed = check.passed();
+      report = check.getReport();
+    }
+    ASSERT_TRUE(passed) << "block " << block << ": " << report;
+  }
+
+  processor.releaseResources();
+}
+}  // namespace audio_plugin_test
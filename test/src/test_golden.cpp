@@ -0,0 +1,394 @@
+#include <delay.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Output regression suite. Fixed stimuli are rendered through every layout, DelayMode,
+// sample rate and a set of parameter corners, and summarised per channel into a few values
+// kept in golden/delay.txt; new builds have to stay within a signal-to-error ratio of them.
+// Separately, every kernel and specialised run path is checked against Kernel::Reference.
+//
+// After an intended change of the output, regenerate the references with
+//   DELAY_UPDATE_GOLDEN=1 ./AudioPluginTest --gtest_filter='Golden.*'
+// and commit golden/delay.txt along with the change.
+
+namespace audio_plugin_test {
+namespace {
+// Against the stored references: an error of 0.03 %, far below anything audible. Builds
+// differ by more than rounding alone, as FMA contraction and libm move the filter
+// coefficients; at 192 kHz that comes to about -75 dB.
+constexpr double minGoldenSnrDb = 70.0;
+
+// Against Kernel::Reference, which only differs in the order of float operations
+constexpr double minKernelSnrDb = 80.0;
+
+constexpr double renderSeconds = 0.75;
+constexpr int blockSize = 256;
+constexpr int numSegments = 16;  // values stored per channel
+
+// Portable white noise, -0.5 .. 0.5; the std distributions differ between libraries
+class Noise {
+public:
+  explicit Noise(uint32_t seed) : state(seed) {}
+
+  float next() {
+    state = state * 1664525u + 1013904223u;
+    return static_cast<float>(state >> 8) / 16777216.0f - 0.5f;
+  }
+
+private:
+  uint32_t state;
+};
+
+enum class Stimulus { Impulse, Sweep, Noise };
+
+// Parameter settings away from the defaults; `change` is applied halfway through the render
+struct Corner {
+  const char* name;
+  void (*apply)(Delay::Parameters&);
+  void (*change)(Delay::Parameters&);
+};
+
+const Corner baseCorner = {"base", [](Delay::Parameters&) {}, nullptr};
+
+const std::vector<Corner> corners = {
+    {"dark",
+     [](Delay::Parameters& p) {
+       p.feedback = 0.95f;
+       p.hiCutFreq = 2000.0f;
+       p.hiCutSlope = FeedbackFilter::Slope::dB48;
+       p.lowCutFreq = 250.0f;
+     },
+     nullptr},
+    {"comb",
+     [](Delay::Parameters& p) {
+       p.delayTimeSeconds = 0.002f;
+       p.feedback = 0.8f;
+       p.hiCutFreq = 0.0f;
+       p.modulationDepthSeconds = 0.0f;
+     },
+     nullptr},
+    {"wide",
+     [](Delay::Parameters& p) {
+       p.modulationDepthSeconds = 0.006f;
+       p.modulationRateHz = 3.0f;
+       p.modulationPhaseOffset = 0.25f;
+     },
+     nullptr},
+    {"unmodulated", [](Delay::Parameters& p) { p.modulationDepthSeconds = 0.0f; }, nullptr},
+    {"taps",
+     [](Delay::Parameters& p) {
+       p.numTaps = 3;
+       p.taps[0] = {0.031f, 0.0f, 0.8f, -0.7f};
+       p.taps[1] = {0.052f, 0.0f, 0.6f, 0.7f};
+       p.taps[2] = {0.13f, 0.0f, 0.4f, 0.0f};
+     },
+     nullptr},
+    {"sync",
+     [](Delay::Parameters& p) {
+       p.syncToTempo = true;
+       p.hostBpm = 133.0f;
+       p.noteDivision = 0.1875f;
+     },
+     nullptr},
+    {"crossfade", [](Delay::Parameters&) {},
+     [](Delay::Parameters& p) { p.delayTimeSeconds = 0.21f; }},
+    {"glide",
+     [](Delay::Parameters& p) {
+       p.timeChange = Delay::TimeChange::Glide;
+       p.timeChangeSeconds = 0.2f;
+     },
+     [](Delay::Parameters& p) { p.delayTimeSeconds = 0.05f; }},
+    {"mode-change", [](Delay::Parameters&) {},
+     [](Delay::Parameters& p) {
+       p.mode = static_cast<Delay::DelayMode>((static_cast<int>(p.mode) + 1) % 3);
+     }},
+};
+
+const Corner& getCorner(const std::string& name) {
+  return *std::find_if(corners.begin(), corners.end(),
+                       [&](const Corner& corner) { return corner.name == name; });
+}
+
+// Discrete channels with linked offsets and modulation apart
+const Corner spreadCorner = {"spread",
+                             [](Delay::Parameters& p) {
+                               p.channelSpreadSeconds = 0.013f;
+                               p.modulationPhaseOffset = 0.5f;
+                             },
+                             nullptr};
+
+const Delay::DelayMode modes[] = {Delay::DelayMode::Mono, Delay::DelayMode::Stereo,
+                                  Delay::DelayMode::PingPong, Delay::DelayMode::Diffuse};
+const Delay::Interpolation interpolations[] = {
+    Delay::Interpolation::None, Delay::Interpolation::Linear, Delay::Interpolation::Hermite,
+    Delay::Interpolation::Lagrange, Delay::Interpolation::Allpass};
+const Delay::StorageFormat formats[] = {
+    Delay::StorageFormat::Float32, Delay::StorageFormat::Float16, Delay::StorageFormat::Int16,
+    Delay::StorageFormat::Float64};
+
+struct Case {
+  int numChannels;  // 1 takes processMono, 2 processStereo, more processMultichannel
+  Delay::DelayMode mode;
+  double sampleRate;
+  Stimulus stimulus;
+  Corner corner;
+  Delay::Interpolation interpolation = Delay::Interpolation::Linear;
+  Delay::StorageFormat format = Delay::StorageFormat::Float32;
+
+  std::string getName() const {
+    static const char* modeNames[] = {"mono", "stereo", "pingpong", "diffuse"};
+    static const char* stimulusNames[] = {"impulse", "sweep", "noise"};
+    static const char* interpolationNames[] = {"none", "linear", "hermite", "lagrange",
+                                               "allpass"};
+    static const char* formatNames[] = {"float32", "float16", "int16", "float64"};
+    std::ostringstream name;
+    name << numChannels << "ch-" << modeNames[static_cast<int>(mode)] << "-"
+         << static_cast<int>(sampleRate) << "-" << stimulusNames[static_cast<int>(stimulus)]
+         << "-" << corner.name << "-" << interpolationNames[static_cast<int>(interpolation)]
+         << "-" << formatNames[static_cast<int>(format)];
+    return name.str();
+  }
+};
+
+using Channels = std::vector<std::vector<float>>;
+
+Channels makeStimulus(Stimulus stimulus, int numChannels, double sampleRate) {
+  const auto numSamples = static_cast<size_t>(renderSeconds * sampleRate);
+  Channels channels(static_cast<size_t>(numChannels), std::vector<float>(numSamples, 0.0f));
+
+  for (size_t c = 0; c < channels.size(); ++c) {
+    auto& x = channels[c];
+    switch (stimulus) {
+      case Stimulus::Impulse:
+        x[c * 97] = 1.0f;  // apart, so cross-feeding shows
+        break;
+      case Stimulus::Sweep: {
+        // Exponential, 40 Hz to 0.45 fs over the first half, then the tail
+        const double f0 = 40.0, f1 = 0.45 * sampleRate, length = 0.5 * renderSeconds;
+        const double k = std::log(f1 / f0);
+        for (size_t i = 0; i < static_cast<size_t>(length * sampleRate); ++i) {
+          const double t = static_cast<double>(i) / sampleRate;
+          const double phase = juce::MathConstants<double>::twoPi * f0 * length / k *
+                               (std::exp(t * k / length) - 1.0);
+          x[i] = 0.5f * static_cast<float>(std::sin(phase + 0.5 * static_cast<double>(c)));
+        }
+        break;
+      }
+      case Stimulus::Noise: {
+        // A burst, so the tail and the idle path follow
+        Noise noise(static_cast<uint32_t>(c + 1));
+        for (size_t i = 0; i < static_cast<size_t>(0.3 * sampleRate); ++i)
+          x[i] = noise.next();
+        break;
+      }
+    }
+  }
+  return channels;
+}
+
+Channels render(const Case& test, Delay::Kernel kernel) {
+  Delay::Parameters params;
+  params.delayTimeSeconds = 0.09f;
+  params.feedback = 0.6f;
+  params.wetLevel = 0.7f;
+  params.dryLevel = 0.8f;
+  params.hiCutFreq = 6000.0f;
+  params.modulationDepthSeconds = 0.001f;
+  params.modulationRateHz = 0.7f;
+  params.interpolation = test.interpolation;
+  params.mode = test.mode;
+  test.corner.apply(params);
+
+  Delay delay;
+  delay.setKernel(kernel);
+  delay.setNumChannels(test.numChannels);
+  delay.setStorageFormat(test.format);
+  delay.setNetworkLayout(test.mode == Delay::DelayMode::Diffuse);
+  delay.setSampleRate(test.sampleRate);
+  delay.setParameters(params);
+
+  auto channels = makeStimulus(test.stimulus, test.numChannels, test.sampleRate);
+  const int numSamples = static_cast<int>(channels[0].size());
+  std::vector<float*> pointers(channels.size());
+
+  for (int start = 0; start < numSamples; start += blockSize) {
+    if (test.corner.change != nullptr && start == numSamples / 2 / blockSize * blockSize) {
+      test.corner.change(params);
+      delay.setParameters(params);
+    }
+
+    const int n = std::min(blockSize, numSamples - start);
+    for (size_t c = 0; c < channels.size(); ++c)
+      pointers[c] = channels[c].data() + start;
+
+    if (test.numChannels == 1)
+      delay.processMono(pointers[0], n);
+    else if (test.numChannels == 2)
+      delay.processStereo(pointers[0], pointers[1], n);
+    else
+      delay.processMultichannel(pointers.data(), n);
+  }
+  return channels;
+}
+
+// Projection of each segment onto a fixed random +-1 sequence, scaled like an RMS level: a
+// few values that still move with any change of any sample, unlike a level envelope
+std::vector<double> summarise(const std::vector<float>& samples) {
+  std::vector<double> values(numSegments, 0.0);
+  Noise signs(7);
+  const size_t length = samples.size() / numSegments;
+  for (size_t s = 0; s < values.size(); ++s) {
+    for (size_t i = s * length; i < (s + 1) * length; ++i)
+      values[s] += signs.next() < 0.0f ? -samples[i] : samples[i];
+    values[s] /= std::sqrt(static_cast<double>(length));
+  }
+  return values;
+}
+
+// 10 log10 of the energy of `reference` over that of the difference
+template <typename T>
+double getSnrDb(const std::vector<T>& actual, const std::vector<T>& reference) {
+  double signal = 0.0, error = 0.0;
+  for (size_t i = 0; i < reference.size(); ++i) {
+    const double r = reference[i];
+    signal += r * r;
+    error += (actual[i] - r) * (actual[i] - r);
+  }
+  if (error == 0.0)
+    return 300.0;
+  return 10.0 * std::log10(std::max(signal, 1.0e-20) / error);
+}
+
+std::vector<Case> getGoldenCases() {
+  const double sampleRates[] = {44100.0, 48000.0, 96000.0, 192000.0};
+  const Stimulus stimuli[] = {Stimulus::Impulse, Stimulus::Sweep, Stimulus::Noise};
+
+  std::vector<Case> cases;
+  for (double sampleRate : sampleRates) {
+    for (auto stimulus : stimuli) {
+      cases.push_back({1, Delay::DelayMode::Mono, sampleRate, stimulus, baseCorner});
+      cases.push_back({1, Delay::DelayMode::Diffuse, sampleRate, stimulus, baseCorner});
+      for (auto mode : modes)
+        cases.push_back({2, mode, sampleRate, stimulus, baseCorner});
+    }
+    for (auto mode : modes)
+      cases.push_back({6, mode, sampleRate, Stimulus::Noise, spreadCorner});
+  }
+
+  // The corners at both ends of the rates
+  for (double sampleRate : {44100.0, 192000.0})
+    for (const auto& corner : corners)
+      for (auto mode : modes)
+        cases.push_back({2, mode, sampleRate, Stimulus::Noise, corner});
+
+  // Every read of every line format
+  for (auto interpolation : interpolations)
+    for (auto format : formats)
+      cases.push_back({2, Delay::DelayMode::PingPong, 48000.0, Stimulus::Noise,
+                       getCorner("wide"), interpolation, format});
+  return cases;
+}
+
+using References = std::map<std::string, std::vector<double>>;  // by "<case> <channel>"
+
+References readReferences(const char* path) {
+  References references;
+  std::ifstream file(path);
+  for (std::string line; std::getline(file, line);) {
+    if (line.empty() || line[0] == '#')
+      continue;
+    std::istringstream fields(line);
+    std::string name, channel;
+    fields >> name >> channel;
+    auto& values = references[name + " " + channel];
+    for (double value; fields >> value;)
+      values.push_back(value);
+  }
+  return references;
+}
+}  // namespace
+
+TEST(Golden, OutputsMatchReferences) {
+  const auto cases = getGoldenCases();
+
+  if (std::getenv("DELAY_UPDATE_GOLDEN") != nullptr) {
+    std::ofstream file(DELAY_GOLDEN_FILE);
+    ASSERT_TRUE(file.good()) << DELAY_GOLDEN_FILE;
+    file << "# Delay output references, see test/src/test_golden.cpp\n"
+         << "# <case> <channel> <projection of each of " << numSegments << " segments>\n";
+    file.precision(7);
+    for (const auto& test : cases) {
+      const auto output = render(test, Delay::Kernel::Simd);
+      for (size_t c = 0; c < output.size(); ++c) {
+        file << test.getName() << " " << c;
+        for (double value : summarise(output[c]))
+          file << " " << value;
+        file << "\n";
+      }
+    }
+    GTEST_SKIP() << "Wrote " << DELAY_GOLDEN_FILE;
+  }
+
+  const auto references = readReferences(DELAY_GOLDEN_FILE);
+  ASSERT_FALSE(references.empty()) << "No references in " << DELAY_GOLDEN_FILE;
+
+  for (const auto& test : cases) {
+    const auto output = render(test, Delay::Kernel::Simd);
+    for (size_t c = 0; c < output.size(); ++c) {
+      const auto key = test.getName() + " " + std::to_string(c);
+      const auto reference = references.find(key);
+      ASSERT_NE(reference, references.end()) << "No reference for " << key;
+      ASSERT_EQ(reference->second.size(), static_cast<size_t>(numSegments)) << key;
+      EXPECT_GE(getSnrDb(summarise(output[c]), reference->second), minGoldenSnrDb) << key;
+    }
+  }
+}
+
+// The SIMD and scalar kernels, each on its specialised run paths, and the multichannel fast
+// paths, sample by sample against the general path
+TEST(Golden, KernelsMatchTheReference) {
+  std::vector<Case> cases;
+  auto addLayouts = [&](const Corner& corner, Delay::Interpolation interpolation,
+                        Delay::StorageFormat format) {
+    for (auto mode : {Delay::DelayMode::Mono, Delay::DelayMode::Diffuse})
+      cases.push_back({1, mode, 48000.0, Stimulus::Noise, corner, interpolation, format});
+    for (auto mode : modes)
+      cases.push_back({2, mode, 48000.0, Stimulus::Noise, corner, interpolation, format});
+    cases.push_back(
+        {6, Delay::DelayMode::PingPong, 48000.0, Stimulus::Noise, corner, interpolation, format});
+  };
+
+  addLayouts(baseCorner, Delay::Interpolation::Linear, Delay::StorageFormat::Float32);
+  for (const auto& corner : corners)
+    addLayouts(corner, Delay::Interpolation::Linear, Delay::StorageFormat::Float32);
+  for (auto interpolation : interpolations) {
+    for (auto format : formats) {
+      addLayouts(getCorner("wide"), interpolation, format);
+      cases.push_back({6, Delay::DelayMode::Stereo, 48000.0, Stimulus::Noise, spreadCorner,
+                       interpolation, format});
+    }
+  }
+
+  for (const auto& test : cases) {
+    const auto reference = render(test, Delay::Kernel::Reference);
+
+    // Only the stereo kernels differ between Simd and Scalar
+    for (auto kernel : {Delay::Kernel::Simd, Delay::Kernel::Scalar}) {
+      if (kernel == Delay::Kernel::Scalar && test.numChannels != 2)
+        continue;
+      const auto output = render(test, kernel);
+      for (size_t c = 0; c < output.size(); ++c)
+        EXPECT_GE(getSnrDb(output[c], reference[c]), minKernelSnrDb)
+            << test.getName() << ", kernel " << static_cast<int>(kernel) << ", channel " << c;
+    }
+  }
+}
+}  // namespace audio_plugin_test
@@ -0,0 +1,199 @@
+#include <delay.h>
+#include <plugin_processor.h>
+#include <gtest/gtest.h>
+#include <mutex>
+#include <vector>
+#include "realtime_check.h"
+
+namespace audio_plugin_test {
+namespace {
+// Reports a running transport, so processBlock takes the tempo path
+class PlayingHead : public juce::AudioPlayHead {
+public:
+  juce::Optional<PositionInfo> getPosition() const override {
+    PositionInfo position;
+    position.setBpm(bpm);
+    position.setIsPlaying(true);
+    return position;
+  }
+
+  double bpm = 120.0;
+};
+
+void setChoice(audio_plugin::AudioPluginAudioProcessor& processor, const char* id, int index) {
+  auto* param = processor.getParameters().getParameter(id);
+  ASSERT_NE(param, nullptr) << id;
+  param->setValueNotifyingHost(param->convertTo0to1(static_cast<float>(index)));
+}
+
+// Moves every continuous parameter (and the channel link) to a random value
+void randomiseParameters(audio_plugin::AudioPluginAudioProcessor& processor,
+                         juce::Random& random) {
+  for (auto* param : static_cast<juce::AudioProcessor&>(processor).getParameters()) {
+    auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(param);
+    if (dynamic_cast<juce::AudioParameterFloat*>(param) != nullptr ||
+        (ranged != nullptr && ranged->getParameterID() == "channelLink"))
+      param->setValueNotifyingHost(random.nextFloat());
+  }
+}
+
+// Processes blocks of random length, moving the parameters before each one; returns the
+// report of the first block that allocated or locked, or an empty string
+std::string processBlocks(audio_plugin::AudioPluginAudioProcessor& processor,
+                          juce::AudioBuffer<float>& buffer,
+                          juce::Random& random,
+                          int numBlocks) {
+  juce::MidiBuffer midi;
+
+  for (int block = 0; block < numBlocks; ++block) {
+    randomiseParameters(processor, random);
+
+    const int numSamples = 1 + random.nextInt(buffer.getNumSamples());
+    juce::AudioBuffer<float> view(buffer.getArrayOfWritePointers(), buffer.getNumChannels(),
+                                  numSamples);
+    for (int c = 0; c < view.getNumChannels(); ++c)
+      for (int i = 0; i < numSamples; ++i)
+        view.setSample(c, i, random.nextFloat() - 0.5f);
+
+    std::string report;
+    {
+      RealtimeCheck check;
+      processor.processBlock(view, midi);
+      if (!check.passed())
+        report = check.getReport();
+    }
+    if (!report.empty())
+      return report;
+  }
+  return {};
+}
+}  // namespace
+
+// Every layout, mode and processing path, with all continuous parameters moving every block
+TEST(RealtimeSafety, ProcessBlockNeitherAllocatesNorLocks) {
+  const double sampleRate = 48000.0;
+  const int maxBlockSize = 512;
+
+  for (int numChannels : {1, 2, 6, Delay::maxChannels}) {
+    audio_plugin::AudioPluginAudioProcessor processor;
+
+    juce::AudioProcessor::BusesLayout layout;
+    layout.inputBuses.add(juce::AudioChannelSet::canonicalChannelSet(numChannels));
+    layout.outputBuses.add(juce::AudioChannelSet::canonicalChannelSet(numChannels));
+    ASSERT_TRUE(processor.setBusesLayout(layout));
+
+    PlayingHead playHead;
+    processor.setPlayHead(&playHead);
+
+    juce::AudioBuffer<float> buffer(numChannels, maxBlockSize);
+    juce::Random random(numChannels);
+
+    // Each combination also takes the next tap count and filter slope, so every mode runs
+    // all of them
+    int combination = 0;
+    for (int mode = 0; mode < 4; ++mode) {
+      // Preparing again gives the line the mode's layout (the network's for Diffuse), as the
+      // timer would while playing
+      setChoice(processor, "mode", mode);
+      processor.prepareToPlay(sampleRate, maxBlockSize);
+
+      for (int interpolation = 0; interpolation < 5; ++interpolation)
+        for (int timeMode = 0; timeMode < 2; ++timeMode)
+          for (int sync = 0; sync < 2; ++sync, ++combination) {
+            const int taps = 1 + combination % Delay::maxTaps;
+            const int hiCutSlope = combination % 3;
+            setChoice(processor, "interpolation", interpolation);
+            setChoice(processor, "timeMode", timeMode);
+            setChoice(processor, "sync", sync);
+            setChoice(processor, "taps", taps);
+            setChoice(processor, "hiCutSlope", hiCutSlope);
+
+            const auto report = processBlocks(processor, buffer, random, 8);
+            ASSERT_TRUE(report.empty())
+                << numChannels << " channels, mode " << mode << ", interpolation "
+                << interpolation << ", timeMode " << timeMode << ", sync " << sync << ", "
+                << taps << " taps, hiCutSlope " << hiCutSlope << ": " << report;
+          }
+    }
+
+    processor.releaseResources();
+  }
+}
+
+// A line resized or converted off the audio thread is swapped in without allocating or
+// freeing there; the old one is released by the caller afterwards
+TEST(RealtimeSafety, DelayLineSwapNeitherAllocatesNorLocks) {
+  Delay delay;
+  delay.setSampleRate(48000.0);
+  delay.setParameters({});
+
+  std::vector<float> left(256, 0.25f), right(256, -0.25f);
+  auto process = [&] {
+    std::string report;
+    {
+      RealtimeCheck check;
+      delay.processStereo(left.data(), right.data(), static_cast<int>(left.size()));
+      if (!check.passed())
+        report = check.getReport();
+    }
+    return report;
+  };
+
+  const double maxDelayTimes[] = {5.0, 2.0, 10.0};
+  for (auto format : {Delay::StorageFormat::Float16, Delay::StorageFormat::Int16,
+                      Delay::StorageFormat::Float64, Delay::StorageFormat::Float32}) {
+    for (double maxDelayTime : maxDelayTimes) {
+      delay.submitDelayLine(delay.createDelayLine(maxDelayTime, format, false));
+
+      // Blocks taking the history over, then the swap
+      for (int block = 0; block < 20; ++block) {
+        const auto report = process();
+        ASSERT_TRUE(report.empty()) << report;
+      }
+
+      delay.releaseRetiredDelayLine();
+    }
+  }
+
+  // A line of the Diffuse mode's layout and back, each waiting blocks for the mode change
+  for (auto mode : {Delay::DelayMode::Diffuse, Delay::DelayMode::Stereo}) {
+    Delay::Parameters params;
+    params.mode = mode;
+    delay.setParameters(params);
+    delay.submitDelayLine(delay.createDelayLine(10.0, Delay::StorageFormat::Float32,
+                                                mode == Delay::DelayMode::Diffuse));
+
+    for (int block = 0; block < 20; ++block) {
+      const auto report = process();
+      ASSERT_TRUE(report.empty()) << report;
+    }
+
+    delay.releaseRetiredDelayLine();
+  }
+}
+
+// The detector itself, so the tests above cannot pass by checking nothing
+TEST(RealtimeSafety, CheckCatchesAllocationsAndLocks) {
+  static std::vector<float>* volatile escaped = nullptr;  // keeps the allocation
+  std::mutex mutex;
+  int allocations = 0;
+  int locks = 0;
+  {
+    RealtimeCheck check;
+    escaped = new std::vector<float>(16);
+    mutex.lock();
+    mutex.unlock();
+    allocations = check.getAllocations();
+    locks = check.getLocks();
+  }
+  delete escaped;
+
+  EXPECT_GT(allocations, 0);
+  if (RealtimeCheck::checksLibc()) {
+    EXPECT_GT(locks, 0);
+  }
+
+  RealtimeCheck check;
+  EXPECT_TRUE(check.passed());
+}
+}  // namespace audio_plugin_test
@@ -16,6 +16,29 @@ export type ParameterValueType = {
 export interface IAudioBackend {
   getParameterState<T extends ParameterType>(name: string, type: T): ParameterMap[T];
   getPluginFunction(name: string): (...args: any[]) => Promise<any>;
+  // Events the plugin pushes (e.g. "meters"); the token unsubscribes
+  addEventListener(event: string, fn: (payload: any) => void): unknown;
+  removeEventListener(token: unknown): void;
+}
+
+// One frame of the "meters" event, as linear gains: the output per channel and the level
+// of each of the first repeats
+export interface MeterFrame {
+  peak: number[];
+  rms: number[];
+  repeats: number[];
+}
+
+// Result of the "getDspLoad" function (plugin built with ENABLE_DSP_LOAD); loads are
+// fractions of the block's duration
+export interface DspLoadStats {
+  numBlocks: number;
+  meanMicroseconds: number;
+  maxMicroseconds: number;
+  meanLoad: number;
+  p99Load: number;
+  maxLoad: number;
+  xrunRiskBlocks: number;
 }
 
 export interface ValueChangeEvent<T> {
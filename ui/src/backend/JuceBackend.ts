@@ -21,6 +21,12 @@ export class JuceBackend implements IAudioBackend {
   getPluginFunction(name: string): (...args: any[]) => Promise<any> {
     return Juce.getNativeFunction(name);
   }
+  addEventListener(event: string, fn: (payload: any) => void): unknown {
+    return window.__JUCE__.backend.addEventListener(event, fn);
+  }
+  removeEventListener(token: unknown): void {
+    window.__JUCE__.backend.removeEventListener(token as [string, number]);
+  }
 }
 
 type JuceGetterMap = {
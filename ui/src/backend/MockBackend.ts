@@ -5,6 +5,7 @@ import type {
   SliderParameter,
   ToggleParameter,
   ComboBoxParameter,
+  MeterFrame,
 } from './IAudioBackend';
 
 export class MockBackend implements IAudioBackend {
@@ -70,5 +71,24 @@ export class MockBackend implements IAudioBackend {
       return Promise.resolve(`Mocked result of ${name}`);
     };
   }
+
+  // "meters" sends a stereo frame with decaying repeats at the plugin's 30 Hz; other events
+  // never fire
+  addEventListener(event: string, fn: (payload: any) => void): unknown {
+    if (event !== 'meters') return undefined;
+    return setInterval(() => {
+      const level = 0.5 + 0.25 * Math.sin(Date.now() / 500);
+      const frame: MeterFrame = {
+        peak: [level, level * 0.9],
+        rms: [level * 0.7, level * 0.6],
+        repeats: Array.from({ length: 8 }, (_, i) => level * Math.pow(0.6, i + 1)),
+      };
+      fn([frame]);
+    }, 1000 / 30);
+  }
+
+  removeEventListener(token: unknown): void {
+    if (token !== undefined) clearInterval(token as ReturnType<typeof setInterval>);
+  }
 }
   
\ No newline at end of file
@@ -0,0 +1,28 @@
+// composables/useDspLoad.ts
+import { ref, onUnmounted, type Ref } from "vue";
+import { useFunction } from "@composables/useFunction";
+import type { DspLoadStats } from "@backend/IAudioBackend";
+
+// Polls "getDspLoad" every `intervalMs`. The function only exists when the plugin is built with
+// ENABLE_DSP_LOAD, so polling stops at the first call that gets no statistics back.
+export function useDspLoad(intervalMs = 1000): Ref<DspLoadStats | null> {
+  const { invoke } = useFunction<DspLoadStats>("getDspLoad");
+  const stats = ref<DspLoadStats | null>(null);
+  let timer: ReturnType<typeof setTimeout> | null = null;
+  let stopped = false;
+
+  const poll = async () => {
+    const result = await invoke();
+    if (stopped || result === null || typeof result !== "object") return;
+    stats.value = result;
+    timer = setTimeout(poll, intervalMs);
+  };
+  poll();
+
+  onUnmounted(() => {
+    stopped = true;
+    if (timer) clearTimeout(timer);
+  });
+
+  return stats;
+}
@@ -0,0 +1,24 @@
+// composables/useMeters.ts
+import { ref, onUnmounted, type Ref } from "vue";
+import { useAudioBackend } from "@composables/useAudioBackend";
+import type { MeterFrame } from "@backend/IAudioBackend";
+
+// Latest frame of the plugin's "meters" event (sent at 30 Hz, several frames per event when
+// the UI falls behind). Peaks are held over the frames of one event so none is missed.
+export function useMeters(): Ref<MeterFrame | null> {
+  const backend = useAudioBackend();
+  const meters = ref<MeterFrame | null>(null);
+
+  const token = backend.addEventListener("meters", (frames: MeterFrame[]) => {
+    if (!Array.isArray(frames) || frames.length === 0) return;
+    const latest = frames[frames.length - 1];
+    const peak = latest.peak.map((_, c) =>
+      Math.max(...frames.map((frame) => frame.peak[c] ?? 0))
+    );
+    meters.value = { ...latest, peak };
+  });
+
+  onUnmounted(() => backend.removeEventListener(token));
+
+  return meters;
+}
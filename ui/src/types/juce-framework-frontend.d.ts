@@ -58,3 +58,13 @@ declare module "juce-framework-frontend" {
     removeListener(id: number): void;
   }
 }
+
+// Events the plugin emits with WebBrowserComponent::emitEventIfBrowserIsVisible
+interface Window {
+  __JUCE__: {
+    backend: {
+      addEventListener(eventId: string, fn: (payload: any) => void): [string, number];
+      removeEventListener(token: [string, number]): void;
+    };
+  };
+}